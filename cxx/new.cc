@@ -4,6 +4,8 @@ extern "C"
 	#include <stdlib.h>
 }
 
+#include <psxmem.h>
+
 void *
 operator new(size_t size)
 {
@@ -27,3 +29,43 @@ operator delete[](void *ptr)
 {
 	free(ptr);
 }
+
+// Arena and pool placement forms, see psxmem.h
+
+void *
+operator new(size_t size, psx_arena &arena) PSX_NOTHROW
+{
+	return PSX_ArenaAlloc(&arena, size);
+}
+
+void *
+operator new[](size_t size, psx_arena &arena) PSX_NOTHROW
+{
+	return PSX_ArenaAlloc(&arena, size);
+}
+
+void
+operator delete(void *ptr, psx_arena &arena) PSX_NOTHROW
+{
+	// Arena memory is only given back by PSX_ArenaReset() and PSX_ArenaRelease().
+}
+
+void
+operator delete[](void *ptr, psx_arena &arena) PSX_NOTHROW
+{
+}
+
+void *
+operator new(size_t size, psx_pool &pool) PSX_NOTHROW
+{
+	if(size > pool.obj_size)
+		return NULL;
+
+	return PSX_PoolAlloc(&pool);
+}
+
+void
+operator delete(void *ptr, psx_pool &pool) PSX_NOTHROW
+{
+	PSX_PoolFree(&pool, ptr);
+}
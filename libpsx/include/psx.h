@@ -76,6 +76,8 @@
 #include <psxsio.h>
 //#include <adpcm.h>
 #include <psxgte.h>
+#include <psxprof.h>
+#include <psxmem.h>
 
 #ifdef __cplusplus
 #define EXTERNC extern "C"
@@ -80,8 +80,10 @@ struct DIRENTRY
 	int size;
 	 /** Pointer to next file entry */
 	struct DIRENTRY *next;
+	 /** First sector of the file (on CD-ROM, its logical block address) */
+	unsigned int head;
 	 /** System reserved */
-	unsigned char system[8];
+	unsigned char system[4];
 };
 
 /**
@@ -80,8 +80,70 @@ enum tCdInt
     INT_MASK = CD_INT7
 };
 
+/** Number of commands which can be queued by CdCommandAsync() */
+#define CD_QUEUE_SIZE   8
+
+/**
+ * Function called when a queued command completes. It is called from the
+ * CD-ROM interrupt handler: it must be short, and it may queue more commands
+ * with CdCommandAsync() but must not wait for them.
+ * @param id Command identifier returned by CdCommandAsync()
+ * @param error 1 if the drive answered with an error (INT5), 0 otherwise
+ * @param result Response bytes, NULL if no result buffer was given
+ * @param count Number of response bytes stored in result
+ */
+typedef void (*CdCommandCallback)(int id, int error, unsigned char *result, int count);
+
+/**
+ * Queues a low-level CD-ROM command and returns at once. Commands are sent
+ * to the drive one after the other by the CD-ROM interrupt handler: the next
+ * one is sent when the drive has answered the previous one (INT3, then INT2
+ * for commands with a second response, or INT5 on errors).
+ * Requires PSX_Init() or PSX_InitEx() with PSX_INIT_CD.
+ *
+ * @param eCmd Command
+ * @param params Parameter bytes
+ * @param num Number of parameter bytes, up to 8
+ * @param result Buffer for the response bytes of all the answers, or NULL
+ * @param max Size of result in bytes
+ * @param callback Function called when the command completes, or NULL
+ * @return Command identifier, -1 if the queue is full or a stream is active
+ */
+int CdCommandAsync(const enum tCdCmd eCmd, const unsigned char *params, int num, unsigned char *result, int max, CdCommandCallback callback);
+
+/**
+ * Checks whether a queued command has completed.
+ * @param id Command identifier returned by CdCommandAsync()
+ * @return 1 if the command has completed, 0 otherwise
+ */
+int CdCommandDone(int id);
+
+/**
+ * Waits for a queued command to complete. Must not be called from a command callback.
+ * The identifier must be one of the last CD_QUEUE_SIZE commands queued.
+ * @param id Command identifier returned by CdCommandAsync()
+ * @return Number of response bytes stored, -1 if the drive answered with an error
+ */
+int CdCommandWait(int id);
+
+/**
+ * Waits until all the queued commands have completed. While commands are queued
+ * the CD-ROM interrupts do not reach the BIOS, so this must be called before using
+ * open(), read() or firstfile() directly on the CD-ROM after queueing commands
+ * (CdPlayTrack() queues commands too). fopen() and fread() call it themselves.
+ * Must not be called from a command callback.
+ */
+void CdCommandWaitAll(void);
+
+/**
+ * Gets the drive status byte of the last answer received from the drive,
+ * without sending a command, e.g. to check CDSTATUS_PLAY after CdPlayTrack().
+ * @return CDROM drive status bitmask
+ */
+int CdLastStatus(void);
+
 /*
- * Sends a low-level CD-ROM command
+ * Sends a low-level CD-ROM command and waits for the answer, using the command queue
  * cmd = command number
  * num = number of arguments
  * ... = arguments
@@ -89,7 +151,7 @@ enum tCdInt
 void CdSendCommand(const enum tCdCmd eCmd, size_t num, ...);
 
 /**
- * Reads the results of a low-level CDROM command
+ * Reads the results of the last command sent with CdSendCommand()
  *
  * @param out Pointer to array of chars where the output will be stored
  * @param max Maximum number of bytes to store
@@ -99,14 +161,17 @@ void CdSendCommand(const enum tCdCmd eCmd, size_t num, ...);
 int CdReadResults(unsigned char *out, const int max);
 
 /**
- * Gets CDROM drive status
+ * Gets CDROM drive status. This waits for the drive to answer; use
+ * CdLastStatus() to poll the status every frame.
  * @return CDROM drive status bitmask
  */
 int CdGetStatus(void);
 
 /**
- * Play an Audio CD track
- * @return 1 on success, 0 on failure
+ * Play an Audio CD track. The commands are queued and this returns at once:
+ * the drive starts playing after seeking to the track. See CdCommandWaitAll()
+ * before using the BIOS file functions directly.
+ * @return 1 on success, 0 if the commands could not be queued
  */
 int CdPlayTrack(unsigned int track);
 
@@ -114,5 +179,133 @@ enum tCdInt CdGetInterrupt(void);
 
 unsigned char CdRamRead(unsigned short addr);
 
+/** Flags for CdStreamStart() */
+
+enum
+{
+    /** Read at normal speed (75 sectors per second) instead of double speed */
+    CD_STREAM_SPEED1 = 1 << 0,
+    /** Read with ReadS instead of ReadN: the drive does not retry sectors with errors,
+        as wanted for audio and video */
+    CD_STREAM_REALTIME = 1 << 1
+};
+
+/** Status returned by CdStreamGetStatus() */
+
+enum
+{
+    /** No stream was started, or it was stopped */
+    CD_STREAM_IDLE,
+    /** The drive is seeking or reading sectors */
+    CD_STREAM_READING,
+    /** The ring buffer is full: the drive waits for sectors to be released */
+    CD_STREAM_PAUSED,
+    /** All the sectors were read and released */
+    CD_STREAM_DONE,
+    /** The drive kept returning errors; the stream was stopped */
+    CD_STREAM_ERROR
+};
+
+/** Statistics of the current stream, see CdStreamGetStats() */
+
+typedef struct
+{
+    /** Sectors stored in the ring buffer */
+    unsigned int sectors;
+    /** Sectors dropped because the ring buffer was full; they are read again later */
+    unsigned int overruns;
+    /** Seeks made to resume reading after a pause or an error */
+    unsigned int restarts;
+    /** Errors reported by the drive */
+    unsigned int errors;
+}CdStreamStats;
+
+/**
+ * Starts reading sectors from the CD-ROM into a ring buffer, in the background.
+ * The drive is programmed directly and each sector is copied by the CD-ROM
+ * interrupt handler, so the program keeps running while the drive reads.
+ * When the ring buffer is full the drive is paused, and reading resumes from
+ * the same place once half of the ring buffer was released.
+ * The BIOS file functions (open(), read(), fopen(), ...) must not be used on
+ * the CD-ROM while a stream is active; call CdStreamStop() first.
+ * Queued commands are completed first, and no command can be queued while
+ * the stream is active.
+ * Requires PSX_Init() or PSX_InitEx() with PSX_INIT_CD.
+ *
+ * @param lba Logical block address of the first sector, see CdFindFile()
+ * @param sectors Number of 2048 byte sectors to read, 0 to read until CdStreamStop()
+ * @param buffer Ring buffer, aligned to 4 bytes, of ring_sectors * 2048 bytes
+ * @param ring_sectors Number of sectors the ring buffer can hold
+ * @param flags CD_STREAM_* flags, or 0
+ * @return 1 on success, 0 if the parameters are not valid
+ */
+
+int CdStreamStart(unsigned int lba, unsigned int sectors, void *buffer, unsigned int ring_sectors, int flags);
+
+/**
+ * Gets the oldest sector of the stream which was not released yet.
+ * @return Pointer to the 2048 bytes of the sector in the ring buffer, NULL if no sector is ready
+ */
+
+void *CdStreamGetSector(void);
+
+/**
+ * Releases the sector returned by CdStreamGetSector(), so that its space in the
+ * ring buffer can be used again. Sectors are released in the order they were read.
+ */
+
+void CdStreamReleaseSector(void);
+
+/**
+ * Gets the status of the stream.
+ * @return CD_STREAM_* status
+ */
+
+int CdStreamGetStatus(void);
+
+/**
+ * Gets statistics about the current stream.
+ * @param stats Pointer to the structure to fill
+ */
+
+void CdStreamGetStats(CdStreamStats *stats);
+
+/**
+ * Stops the stream, waiting for the drive to pause, and gives the drive back to the BIOS.
+ * Sectors which were not released yet are lost.
+ */
+
+void CdStreamStop(void);
+
+/**
+ * Gets the location of a file on the CD-ROM, to stream it with CdStreamStart().
+ * Uses the BIOS, so it must not be called while a stream is active.
+ * @param name File name, e.g. "cdrom:\\MOVIE.STR;1"
+ * @param lba Pointer to store the logical block address of the file, or NULL
+ * @param size Pointer to store the size of the file in bytes, or NULL
+ * @return 1 if the file was found, 0 otherwise
+ */
+
+int CdFindFile(char *name, unsigned int *lba, unsigned int *size);
+
+/**
+ * Builds the index of the long file names used by fopen() for "cdromL:" paths,
+ * reading every TRANS.TBL on the disc once. After that, opening a cdromL: file
+ * only has to look its name up in the index. The index is built by the first
+ * fopen() of a cdromL: file if this was not called before; call it again when
+ * the disc is changed. If the root TRANS.TBL can't be read the index stays
+ * empty, and no cdromL: file can be opened, until this or CdIndexFree() is called.
+ * @return Number of files in the index, -1 if the root TRANS.TBL could not be read
+ */
+
+int CdIndexBuild(void);
+
+/**
+ * Frees the memory used by the index of long file names.
+ * It is built again by the next fopen() of a cdromL: file.
+ */
+
+void CdIndexFree(void);
+
 
 #endif
@@ -79,7 +79,7 @@ int GsSetVideoModeEx(int width, int height, int video_mode, int rgb24, int inter
  * Assigns the internal pointer to the primitive list to the desired one,
  * and resets the linked list position counter.
  * The memory address specified by your pointer has to have enough space free to contain all
- * the packets which you want to send.
+ * the packets which you want to send, unless the size of the list was set with GsSetListCapacity().
  * \param listptr Pointer to primitive list
  */
 
@@ -126,6 +126,171 @@ void GsDrawListPIO(void);
 
 void GsSetAutoWait(void);
 
+/**
+ * Enables or disables draw mode tracking, which is enabled by default.
+ * When enabled, primitives added in sequence leave out their draw mode setting
+ * (texture page, color mode and translucency) if it is the same as the one
+ * set by the primitive before them, making packets one word shorter.
+ * Tracking starts again every time the list is reset by GsSetList() or GsDrawList().
+ * Primitives sorted in an ordering table always carry their own draw mode setting.
+ * Disable it if your code relies on the size of the packets added by the GsSort*() functions.
+ * \param enabled 1 to enable draw mode tracking, 0 to disable it
+ */
+
+void GsSetDrawModeTracking(int enabled);
+
+/** Maximum number of primitive lists which can be registered with GsListInit() */
+
+#define GS_LIST_MAX_BUFFERS     3
+
+/**
+ * Registers two or three primitive lists to be used in turn, and makes the first one current.
+ *
+ * While the GPU is being fed from a list submitted with GsListSubmit(), the next frame
+ * can be built in another list, so that the CPU and the GPU work at the same time.
+ * A single list can be registered too, then GsListSwap() always waits for the transfer to end.
+ *
+ * \param buffers Array of pointers to primitive lists
+ * \param count Number of primitive lists (1 to GS_LIST_MAX_BUFFERS, extra ones are ignored)
+ * \return 1 on success, 0 if count is 0 (the current list is then left unchanged)
+ */
+
+int GsListInit(unsigned int *const *buffers, unsigned int count);
+
+/**
+ * Starts the DMA transfer of the current primitive list and returns immediately.
+ *
+ * Unlike GsDrawList() this function does not wait for the GPU to finish drawing before
+ * starting the transfer; it only waits for a transfer still in progress to end.
+ * Do not modify the submitted list until GsListSwap() gives it back.
+ */
+
+void GsListSubmit(void);
+
+/**
+ * Makes the next registered primitive list current, and returns a pointer to it.
+ * Blocks only if the transfer of that list is still in progress.
+ * \return Pointer to the new current primitive list
+ */
+
+unsigned int *GsListSwap(void);
+
+/**
+ * Checks if the last list submitted with GsListSubmit() is still being transferred
+ * \return 1 if the transfer is in progress, 0 otherwise
+ */
+
+int GsListIsBusy(void);
+
+/**
+ * Sets the size of the primitive lists set with GsSetList(), GsSetListEx() and GsListInit().
+ *
+ * When a primitive does not fit in the list anymore, the list continues in the
+ * overflow buffer set with GsSetListOverflow(); if there is none, or it is full too,
+ * the primitive is not added and is counted as dropped (see GsListGetStats()).
+ * One word of each buffer is kept free for the end of the list.
+ * \param words Size of the primitive lists in words, 0 for no limit (the default)
+ */
+
+void GsSetListCapacity(unsigned int words);
+
+/**
+ * Sets a buffer where the primitive list continues when it runs out of space.
+ * It is used only when a capacity was set with GsSetListCapacity(), and at most once per list.
+ * When lists are double buffered with GsListSubmit(), the same overflow buffer
+ * can be used by a list still being transferred: wait for GsListIsBusy() to return 0
+ * before building a list which might need it.
+ * \param buffer Pointer to the overflow buffer, NULL for none
+ * \param words Size of the overflow buffer in words
+ */
+
+void GsSetListOverflow(unsigned int *buffer, unsigned int words);
+
+/** Primitive list usage counters */
+
+typedef struct
+{
+    /** Number of words used by the list being built */
+    unsigned int used;
+    /** Largest number of words used by a list, overflow buffer included */
+    unsigned int high_water;
+    /** Number of lists which continued in the overflow buffer */
+    unsigned int overflows;
+    /** Number of primitives which were not added because the list was full */
+    unsigned int dropped;
+}GsListStats;
+
+/**
+ * Gets the primitive list usage counters, which can be used to size
+ * the primitive lists from real data
+ * \param stats Pointer to GsListStats structure to fill
+ */
+
+void GsListGetStats(GsListStats *stats);
+
+/**
+ * Resets the primitive list usage counters
+ */
+
+void GsListResetStats(void);
+
+/** Block of packets compiled once with GsBlockBegin() and GsBlockEnd() */
+
+typedef struct
+{
+    /** Header of the first packet, NULL if the block is empty */
+    unsigned int *first;
+    /** Header of the last packet */
+    unsigned int *last;
+    /** Number of words used in the block buffer */
+    unsigned int size;
+}GsBlock;
+
+/**
+ * Starts compiling a block of packets.
+ * Until GsBlockEnd() is called, the GsSort*() functions and GsPrintFont() put their
+ * packets in the specified buffer instead of the primitive list, always in sequence:
+ * the GsSort*Z() functions do not use the ordering table while a block is compiled.
+ * The block can then be added to every frame with GsSortBlock(), without
+ * building its packets again. This suits geometry which does not change, like menus
+ * and backgrounds.
+ * Blocks can not be nested.
+ * \param block Pointer to the block to compile
+ * \param buffer Buffer which will contain the packets; it has to stay valid as long as the block is used
+ * \param words Size of the buffer in words
+ */
+
+void GsBlockBegin(GsBlock *block, unsigned int *buffer, unsigned int words);
+
+/**
+ * Ends compiling the block started with GsBlockBegin(),
+ * and goes back to putting packets in the primitive list.
+ * \return 0 on success, -1 if some primitives did not fit in the block buffer and were left out
+ */
+
+int GsBlockEnd(void);
+
+/**
+ * Adds a compiled block to the primitive list. Only the link to the block is
+ * written, the packets in it are not copied.
+ * The last packet of the block links back to the primitive list being built, so a block can be
+ * added only once to each list, and not to a list while another one using it is still being drawn.
+ * \param block Pointer to the compiled block
+ */
+
+void GsSortBlock(const GsBlock *block);
+
+/**
+ * Adds a compiled block to the primitive list, like GsSortBlock(), moving it
+ * by the specified amount. A drawing offset packet (0xE5) is put before the block and
+ * the drawing offset of the current drawing environment is restored after it.
+ * \param block Pointer to the compiled block
+ * \param x Horizontal offset
+ * \param y Vertical offset
+ */
+
+void GsSortBlockOffset(const GsBlock *block, int x, int y);
+
 /** Monochrome 3 point polygon */
 
 typedef struct
@@ -459,26 +624,26 @@ typedef struct
 
 /** Map */
 
-//typedef struct
-//{
-//  short x, y; /* X, Y positions */
-//  unsigned char u, v; /* Offset into texture page of sprite image data */
-//  short w, h; /* Width and height of tilemap */
-//  short l; /* Length of tilemap line */
-//  short cx, cy; /* Color look up table (palette) X, Y positions */
-//  unsigned char r, g, b; /* Luminosity of color components - 128 is normal luminosity */
-//  unsigned char tpage; /* Texture page */
-//  unsigned int attribute; /* Attribute */
-//
-//  unsigned short tmw, tmh; /* Map texture width and height */
-//  unsigned char tw, th; /* Map tile width and height */
-//
-//  unsigned char tsize; /* Size of tile in map (1 = 8-bit, 2 = 16-bit, 4 = 32-bit) */
-//
-//  unsigned int tmask; /* Inverted mask for tile number */
-//
-//  void *data; /* Pointer to beginning of map data */
-//}GsMap;
+typedef struct
+{
+    short x, y; /* X, Y positions of the top-left corner of the map on screen - change them to scroll the map */
+    unsigned char u, v; /* Offset into texture page of the tileset image data */
+    short w, h; /* Width and height of tilemap, in tiles */
+    short l; /* Length of tilemap line, in tiles */
+    short cx, cy; /* Color look up table (palette) X, Y positions */
+    unsigned char r, g, b; /* Luminosity of color components - 128 is normal luminosity */
+    unsigned char tpage; /* Texture page */
+    unsigned int attribute; /* Attribute */
+
+    unsigned short tmw, tmh; /* Map texture (tileset) width and height */
+    unsigned char tw, th; /* Map tile width and height */
+
+    unsigned char tsize; /* Size of tile in map (1 = 8-bit, 2 = 16-bit, 4 = 32-bit) */
+
+    unsigned int tmask; /* Inverted mask for tile number */
+
+    void *data; /* Pointer to beginning of map data */
+}GsMap;
 
 /** Texture color modes. */
 
@@ -762,6 +927,19 @@ void GsSortSimpleSprite(const GsSprite* const sprite);
 
 void GsSortRectangle(const GsRectangle* const rectangle);
 
+/**
+ * Adds a tilemap to the packet list
+ *
+ * Only the tiles which are inside the current drawing area are added.
+ * Tiles are numbered from left to right and from top to bottom in the tileset,
+ * and all of them share a single draw mode setting.
+ * 8x8 and 16x16 tiles are drawn with the fixed size sprite primitives,
+ * which are smaller and faster to send than the ones used by GsSortSimpleSprite().
+ * \param map Pointer to structure for map
+ */
+
+void GsSortSimpleMap(const GsMap* const map);
+
 /**
  * Moves image data from a part of the framebuffer to another.
  * Actually it does a copy.
@@ -777,6 +955,10 @@ void MoveImage(int src_x, int src_y, int dst_x, int dst_y, int w, int h);
 
 /**
  * Loads image data into framebuffer memory.
+ *
+ * The data is transferred by DMA in block mode, and the function returns
+ * when the transfer has ended. In No-BIOS mode, port I/O is used instead.
+ * Image data must be in main RAM (not in the scratch pad) and aligned to 4 bytes.
  * \param img Pointer to raw image data
  * \param x Top-left X coordinate of destination area
  * \param y Top-left Y coordinate of destination area
@@ -786,6 +968,31 @@ void MoveImage(int src_x, int src_y, int dst_x, int dst_y, int w, int h);
 
 void LoadImage(void *img, int x, int y, int w, int h);
 
+/**
+ * Works like LoadImage(), but returns as soon as the DMA transfer has started.
+ *
+ * The image data must not be modified, and no other GPU function must be called,
+ * until LoadImageDone() reports that the transfer has ended.
+ * Functions starting a new DMA transfer, like GsDrawList() and LoadImage(), wait for it
+ * to end by themselves.
+ * If the image data cannot be divided in whole DMA blocks (very large images whose size
+ * in 32-bit words is not a multiple of 16) this function blocks until the transfer has ended.
+ * \param img Pointer to raw image data
+ * \param x Top-left X coordinate of destination area
+ * \param y Top-left Y coordinate of destination area
+ * \param w Width of image data
+ * \param h Height of image data
+ */
+
+void LoadImageAsync(void *img, int x, int y, int w, int h);
+
+/**
+ * Checks if the DMA transfer started by LoadImageAsync() has ended
+ * \return 1 if no transfer is in progress, 0 otherwise
+ */
+
+int LoadImageDone(void);
+
 /**
  * Draws a rectangle in the framebuffer, without considering drawing
  * and display environments (i.e. it does so in an absolute way)
@@ -879,6 +1086,169 @@ void GsUploadCLUT(GsImage *image);
 
 int GsSpriteFromImage(GsSprite* const sprite, GsImage* const image, int do_upload);
 
+/**
+ * Forgets about every region of video memory allocated or reserved
+ * with the GsVram*() functions.
+ */
+
+void GsVramReset(void);
+
+/**
+ * Marks an area of video memory as used, so that the allocator never gives it out.
+ * Use it for the display and drawing buffers, the font and anything else
+ * which is placed at fixed coordinates.
+ * \param x Top-left X coordinate of area
+ * \param y Top-left Y coordinate of area
+ * \param w Width of area
+ * \param h Height of area
+ * \return 1 on success, 0 if the area overlaps an allocated one or there are no free slots
+ */
+
+int GsVramReserve(int x, int y, int w, int h);
+
+/**
+ * Allocates an area of video memory for a texture.
+ *
+ * The area does not straddle a texture page vertically, and either fits in a
+ * single texture page horizontally or, if wider than 64 pixels, starts on a texture page boundary.
+ * Sizes are in framebuffer pixels (16-bit units), like the w and h fields of GsImage.
+ * \param w Width of area (up to 256)
+ * \param h Height of area (up to 256)
+ * \param x Pointer to variable where the X coordinate of the area will be stored
+ * \param y Pointer to variable where the Y coordinate of the area will be stored
+ * \return 1 on success, 0 on failure
+ */
+
+int GsVramAlloc(int w, int h, int *x, int *y);
+
+/**
+ * Allocates an area of video memory for a CLUT.
+ * The X coordinate of the area is a multiple of 16, as required by the GPU.
+ * \param w Width of CLUT (16 for 4-bit images, 256 for 8-bit images)
+ * \param h Height of CLUT
+ * \param x Pointer to variable where the X coordinate of the area will be stored
+ * \param y Pointer to variable where the Y coordinate of the area will be stored
+ * \return 1 on success, 0 on failure
+ */
+
+int GsVramAllocClut(int w, int h, int *x, int *y);
+
+/**
+ * Frees an area of video memory allocated or reserved before.
+ * \param x Top-left X coordinate of area
+ * \param y Top-left Y coordinate of area
+ * \return 1 on success, 0 if no area starts at the specified coordinates
+ */
+
+int GsVramFree(int x, int y);
+
+/**
+ * Allocates video memory for an image, and its CLUT if it has one, and
+ * relocates the image there by changing its coordinates.
+ * Call it after GsImageFromTim() and before GsUploadImage() or GsSpriteFromImage();
+ * the coordinates stored in the TIM file are ignored.
+ * \param image Pointer to GsImage structure
+ * \return 1 on success, 0 on failure (the image is left unchanged)
+ */
+
+int GsVramAllocImage(GsImage *image);
+
+/**
+ * Frees the video memory used by an image relocated by GsVramAllocImage().
+ * \param image Pointer to GsImage structure
+ */
+
+void GsVramFreeImage(GsImage *image);
+
+/**
+ * Texture managed by the texture cache
+ */
+
+typedef struct GsTexture
+{
+    /** Image, the coordinates are assigned when the texture is made resident */
+    GsImage image;
+    /** 1 if the texture is in video memory, 0 otherwise */
+    int resident;
+    /** Frame in which the texture was last used */
+    unsigned int last_use;
+    /** Next texture known to the cache (internal) */
+    struct GsTexture *next;
+}GsTexture;
+
+/**
+ * Texture cache counters
+ */
+
+typedef struct
+{
+    /** Number of GsTexBind() calls for resident textures */
+    unsigned int hits;
+    /** Number of GsTexBind() calls for textures which were not resident */
+    unsigned int misses;
+    /** Number of uploads to video memory */
+    unsigned int uploads;
+    /** Number of bytes uploaded to video memory, CLUTs included */
+    unsigned int upload_bytes;
+    /** Number of textures evicted from video memory */
+    unsigned int evictions;
+}GsTexCacheStats;
+
+/**
+ * Makes a TIM image known to the texture cache, without uploading it.
+ *
+ * Video memory is allocated with the GsVram*() functions, so areas which must not
+ * be used for textures (display and drawing buffers, etc.) have to be reserved with GsVramReserve().
+ * The TIM data must stay in memory as long as the texture is known to the cache,
+ * as it will be uploaded again if it is evicted and used later.
+ * Calling it again on a known texture releases it first, as GsTexRelease() does.
+ * \param tex Pointer to GsTexture structure
+ * \param timdata Pointer to TIM image data
+ * \return 1 on success, 0 if the TIM data is not valid
+ */
+
+int GsTexInit(GsTexture *tex, const void *timdata);
+
+/**
+ * Removes a texture from the texture cache, and frees its video memory.
+ * \param tex Pointer to GsTexture structure
+ */
+
+void GsTexRelease(GsTexture *tex);
+
+/**
+ * Makes sure a texture is in video memory, uploading it if needed, and
+ * sets the texture page, texture offsets and CLUT coordinates of a sprite accordingly.
+ *
+ * When there is no space left in video memory, the least recently used textures
+ * are evicted; textures used since the last call to GsTexNextFrame() are never evicted.
+ * \param tex Pointer to GsTexture structure
+ * \param sprite Pointer to sprite to update, or NULL
+ * \return 1 on success, 0 if the texture could not be made resident
+ */
+
+int GsTexBind(GsTexture *tex, GsSprite *sprite);
+
+/**
+ * Tells the texture cache that a new frame has started.
+ * Call it once per frame, after the previous frame was drawn.
+ */
+
+void GsTexNextFrame(void);
+
+/**
+ * Gets the texture cache counters
+ * \param stats Pointer to GsTexCacheStats structure to fill
+ */
+
+void GsTexGetStats(GsTexCacheStats *stats);
+
+/**
+ * Resets the texture cache counters
+ */
+
+void GsTexResetStats(void);
+
 /**
  * Checks if the GPU is drawing
  * \return 1 if GPU is drawing, 0 otherwise
@@ -918,6 +1288,9 @@ void GsLoadFont(int fb_x, int fb_y, int cx, int cy);
 
 /**
  * Prints string using 8x8 font at screen coordinates x, y
+ *
+ * When the text is not scaled, it is added to the packet list as a single chain of
+ * fixed size sprites sharing one draw mode setting.
  * \param x X coordinate
  * \param y Y coordinate
  * \param fmt format (like *printf())
@@ -981,6 +1354,63 @@ void GsSetFont(int fb_x, int fb_y, int cx, int cy);
 
 void GsSetFontAttrib(unsigned int flags);
 
+/**
+ * Text laid out once with the built-in font, which can be drawn many times.
+ */
+
+typedef struct
+{
+    /** Pointer to packet buffer */
+    unsigned int *packets;
+    /** Size of packet buffer, in 32-bit words */
+    unsigned int size;
+    /** Number of words used in packet buffer */
+    unsigned int used;
+    /** Offset of the last packet header in packet buffer (internal) */
+    unsigned int last;
+    /** Position the text is currently laid out at (internal) */
+    short x, y;
+}GsText;
+
+/**
+ * Initializes a text object
+ *
+ * Each printed character needs three words in the packet buffer,
+ * plus a few words for the draw mode setting and packet headers.
+ * \param text Pointer to text object
+ * \param buffer Pointer to packet buffer
+ * \param size Size of packet buffer, in 32-bit words
+ * \return 1
+ */
+
+int GsTextInit(GsText *text, unsigned int *buffer, unsigned int size);
+
+/**
+ * Lays out a string in a text object, replacing its previous content.
+ *
+ * The current font, luminance factors, PRFONT_UNIXLF, PRFONT_CENTER and PRFONT_RIGHT
+ * attributes are used, scaling and PRFONT_WRAP are ignored.
+ * \param text Pointer to text object
+ * \param fmt format (like *printf())
+ * \return 1 on success, 0 if the packet buffer is too small (the text object is then empty)
+ */
+
+int GsTextPrint(GsText *text, const char *fmt, ...);
+
+/**
+ * Adds a text object to the packet list at screen coordinates x, y
+ *
+ * The packets are not copied: only the character positions are updated, if they changed,
+ * and the packets are linked to the primitive list. So a text object can be added only once
+ * per primitive list, and must not be modified until the list has been drawn.
+ * Characters outside the drawing area are not culled.
+ * \param text Pointer to text object
+ * \param x X coordinate
+ * \param y Y coordinate
+ */
+
+void GsSortText(GsText *text, int x, int y);
+
 /**
  * Sets drawing environment
  * Enables drawing on the display area, disables dithering and disables all masking flags by default
@@ -1129,6 +1559,22 @@ void GsSortCls(int r, int g, int b);
 
 void GsRotateVector(int x_a, int y_a, int z_a, double *v, double *n);
 
+/**
+ * Integer version of GsRotateVector(), which does not need floating point emulation.
+ *
+ * Calculations are done in 4.12 fixed point notation, with the same one degree
+ * precision as GsRotateVector(). The coordinates are integers in any unit,
+ * but their absolute value must not be higher than 32767.
+ *
+ * \param x_a Rotation angle about the X axis (ROTATE_ONE = 1 degree)
+ * \param y_a Rotation angle about the Y axis (ROTATE_ONE = 1 degree)
+ * \param z_a Rotation angle about the Z axis (ROTATE_ONE = 1 degree)
+ * \param v Pointer to an array of coordinates for the source vector
+ * \param n Pointer to destination array for the coordinates of the rotated vector
+ */
+
+void GsRotateVectorFx(int x_a, int y_a, int z_a, const int *v, int *n);
+
 /**
  * Adds a monochrome polyline to the packet list
  * \param line Pointer to structure for monochrome polyline
@@ -1143,6 +1589,55 @@ void GsSortPolyLine(const GsPolyLine* const line);
 
 void GsSortGPolyLine(const GsGPolyLine* const line);
 
+/**
+ * Initializes an ordering table and makes it the current one.
+ *
+ * An ordering table is an array of empty packets, one for each depth bucket,
+ * chained so that entry [entries - 1] is drawn first and entry 0 is drawn last.
+ * The GsSort*Z() functions insert primitives at the head of the bucket for the
+ * specified depth, so primitives can be submitted in any order and are drawn
+ * from the deepest to the nearest without sorting them on the CPU.
+ *
+ * The packets themselves are still stored in the primitive list set with GsSetList().
+ * GsDrawList() draws the primitives added with the plain GsSort*() functions first,
+ * then the ordering table. After GsDrawList() the ordering table is released,
+ * so GsOTInit() must be called again for every frame.
+ *
+ * \param ot Pointer to an array of at least entries words
+ * \param entries Number of depth buckets (at least 1)
+ */
+
+void GsOTInit(unsigned int *ot, unsigned int entries);
+
+/**
+ * Ordering table variants of the GsSort*() functions.
+ *
+ * They work like their counterparts, but link the primitive in the bucket
+ * for depth z of the current ordering table. Depth 0 is the nearest to the viewer,
+ * and a depth beyond the size of the table is clamped to the deepest bucket.
+ * Primitives with the same depth are drawn in reverse order of submission.
+ * If no ordering table is set, they behave exactly like their counterparts.
+ */
+
+void GsSortPoly3Z(const GsPoly3* const poly3, const unsigned int z);
+void GsSortPoly4Z(const GsPoly4* const poly4, const unsigned int z);
+void GsSortGPoly3Z(const GsGPoly3* const poly3, const unsigned int z);
+void GsSortGPoly4Z(const GsGPoly4* const poly4, const unsigned int z);
+void GsSortTPoly3Z(const GsTPoly3* const tpoly3, const unsigned int z);
+void GsSortTPoly4Z(const GsTPoly4* const tpoly4, const unsigned int z);
+void GsSortGTPoly3Z(const GsGTPoly3* const tpoly3, const unsigned int z);
+void GsSortGTPoly4Z(const GsGTPoly4* const tpoly4, const unsigned int z);
+void GsSortLineZ(const GsLine* const line, const unsigned int z);
+void GsSortGLineZ(const GsGLine* const line, const unsigned int z);
+void GsSortDotZ(const GsDot* const dot, const unsigned int z);
+void GsSortSpriteZ(const GsSprite* const sprite, const unsigned int z);
+void GsSortSimpleSpriteZ(const GsSprite* const sprite, const unsigned int z);
+void GsSortRectangleZ(const GsRectangle* const rectangle, const unsigned int z);
+void GsSortPolyLineZ(const GsPolyLine* const line, const unsigned int z);
+void GsSortGPolyLineZ(const GsGPolyLine* const line, const unsigned int z);
+void GsSortSimpleMapZ(const GsMap* const map, const unsigned int z);
+void GsSortBlockZ(const GsBlock* const block, const unsigned int z);
+
 /**
  * Experimental!
  * \param drawenv Pointer to drawing struct
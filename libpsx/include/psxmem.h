@@ -0,0 +1,203 @@
+#ifndef _PSXMEM_H
+#define _PSXMEM_H
+
+/*
+ * Arena and pool allocators, and heap statistics.
+ *
+ * Arenas and pools work in a buffer supplied by the caller (static, or obtained once
+ * with malloc()) and never call malloc() themselves.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Arena (bump pointer) allocator */
+
+typedef struct
+{
+	/** Start of the buffer */
+	unsigned char *base;
+	/** Size of the buffer in bytes */
+	unsigned int size;
+	/** Bytes used */
+	unsigned int pos;
+	/** Largest number of bytes used since PSX_ArenaInit() */
+	unsigned int high_water;
+}psx_arena;
+
+/** Fixed size object pool */
+
+typedef struct
+{
+	/** First free object, NULL if the pool is full */
+	void *free_list;
+	/** Size of an object in bytes, rounded up to a multiple of 8 */
+	unsigned int obj_size;
+	/** Number of objects in the pool */
+	unsigned int count;
+	/** Number of objects allocated */
+	unsigned int used;
+}psx_pool;
+
+/**
+ * Sets up an arena in the specified buffer.
+ * @param arena Pointer to the arena
+ * @param buffer Buffer for the arena, aligned to 8 bytes
+ * @param size Size of the buffer in bytes
+ */
+
+void PSX_ArenaInit(psx_arena *arena, void *buffer, unsigned int size);
+
+/**
+ * Allocates memory from an arena. Memory allocated from an arena can not be freed
+ * by itself, it is all given back at once by PSX_ArenaReset() or PSX_ArenaRelease().
+ * @param arena Pointer to the arena
+ * @param size Size in bytes
+ * @return Pointer to the memory, aligned to 8 bytes, or NULL if the arena is full
+ */
+
+void *PSX_ArenaAlloc(psx_arena *arena, unsigned int size);
+
+/**
+ * Frees all the memory allocated from an arena, for example at the start of every frame.
+ * @param arena Pointer to the arena
+ */
+
+void PSX_ArenaReset(psx_arena *arena);
+
+/**
+ * Gets the current position in an arena, to free what is allocated after it
+ * with PSX_ArenaRelease().
+ * @param arena Pointer to the arena
+ * @return Current position
+ */
+
+unsigned int PSX_ArenaMark(psx_arena *arena);
+
+/**
+ * Frees all the memory allocated from an arena after PSX_ArenaMark() returned mark.
+ * @param arena Pointer to the arena
+ * @param mark Position returned by PSX_ArenaMark()
+ */
+
+void PSX_ArenaRelease(psx_arena *arena, unsigned int mark);
+
+/**
+ * Sets up a pool of objects of the same size in the specified buffer.
+ * @param pool Pointer to the pool
+ * @param buffer Buffer for the pool, aligned to 8 bytes
+ * @param size Size of the buffer in bytes
+ * @param obj_size Size of an object in bytes
+ * @return Number of objects which fit in the buffer
+ */
+
+unsigned int PSX_PoolInit(psx_pool *pool, void *buffer, unsigned int size, unsigned int obj_size);
+
+/**
+ * Allocates an object from a pool, in constant time.
+ * @param pool Pointer to the pool
+ * @return Pointer to the object, or NULL if all the objects are allocated
+ */
+
+void *PSX_PoolAlloc(psx_pool *pool);
+
+/**
+ * Gives an object back to the pool it was allocated from, in constant time.
+ * @param pool Pointer to the pool
+ * @param ptr Pointer to the object; NULL is ignored
+ */
+
+void PSX_PoolFree(psx_pool *pool, void *ptr);
+
+/** Heap statistics, see PSX_HeapGetStats() */
+
+typedef struct
+{
+	/** Size of the heap in bytes */
+	unsigned int total;
+	/** Bytes in allocated blocks, block headers included */
+	unsigned int used;
+	/** Largest value of used since malloc() was set up */
+	unsigned int peak;
+	/** Bytes in free blocks */
+	unsigned int free;
+	/** Number of free blocks */
+	unsigned int free_blocks;
+	/** Largest size which can be allocated right now */
+	unsigned int largest_free;
+	/** Number of allocations not freed yet */
+	unsigned int allocations;
+	/** Number of successful allocations since malloc() was set up */
+	unsigned int total_allocations;
+	/** Number of allocations which failed */
+	unsigned int failures;
+}psx_heap_stats;
+
+/**
+ * Gets statistics about the heap used by malloc().
+ * When malloc() returns NULL while free is large, compare largest_free to
+ * the size requested: the free memory is split in blocks which are too small.
+ * This walks the whole heap, so it is not meant to be called every frame.
+ * @param stats Pointer to the structure to fill
+ */
+
+void PSX_HeapGetStats(psx_heap_stats *stats);
+
+/**
+ * Enables or disables heap debug mode. Blocks allocated while it is enabled are
+ * 16 bytes bigger and record the requested size, the address of the caller and
+ * a sequence number, which PSX_HeapDump() prints.
+ * @param enabled 1 to enable debug mode, 0 to disable it
+ */
+
+void PSX_HeapSetDebug(int enabled);
+
+/**
+ * Gets the sequence number of the last allocation, to list with PSX_HeapDump()
+ * only what is allocated after this point, for example while a level is loaded.
+ * @return Sequence number
+ */
+
+unsigned int PSX_HeapMark(void);
+
+/**
+ * Prints heap statistics using sio_printf(), followed by the allocations made in debug mode
+ * after the sequence number since which were not freed yet. Use the caller address
+ * with the map file of the program to know where leaked memory was allocated.
+ * @param since Sequence number returned by PSX_HeapMark(), 0 to list all the allocations
+ */
+
+void PSX_HeapDump(unsigned int since);
+
+#ifdef __cplusplus
+}
+
+/*
+ * Placement forms of operator new which allocate from an arena or a pool,
+ * defined in libstdc++.a (cxx/new.cc):
+ *   Particle *p = new (frame_arena) Particle;
+ * Objects in an arena are not deleted one by one: call their destructor if needed,
+ * then reset the arena. Objects in a pool are given back with their destructor and PSX_PoolFree().
+ * They return NULL when the arena or pool is full.
+ */
+
+#if __cplusplus >= 201103L
+#define PSX_NOTHROW noexcept
+#else
+#define PSX_NOTHROW throw()
+#endif
+
+extern "C++"
+{
+	void *operator new(__SIZE_TYPE__ size, psx_arena &arena) PSX_NOTHROW;
+	void *operator new[](__SIZE_TYPE__ size, psx_arena &arena) PSX_NOTHROW;
+	void operator delete(void *ptr, psx_arena &arena) PSX_NOTHROW;
+	void operator delete[](void *ptr, psx_arena &arena) PSX_NOTHROW;
+	void *operator new(__SIZE_TYPE__ size, psx_pool &pool) PSX_NOTHROW;
+	void operator delete(void *ptr, psx_pool &pool) PSX_NOTHROW;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef _PSXPROF_H
+#define _PSXPROF_H
+
+/*
+ * Frame profiler.
+ *
+ * Times are measured with root counter 2, running at system clock / 8
+ * (one tick is about 0.236 microseconds). The counter is 16-bit and wraps around
+ * about every 15 ms, less than a video frame, so root counter 1 counts scanlines
+ * at the same time to find out how many times it did: the profiler keeps a 32-bit count,
+ * as long as it is called at least once a second (PSX_ProfFrame() every frame is enough).
+ * Neither counter can be used for anything else while the profiler is enabled.
+ * The profiler functions are not meant to be called from interrupt handlers.
+ */
+
+/** Maximum number of scopes, the predefined ones included */
+
+#define PROF_MAX_SCOPES		16
+
+/** Number of frames kept in the history ring buffer */
+
+#define PROF_HISTORY		16
+
+/** Predefined scopes, measuring the time the CPU spends waiting in libpsx */
+
+enum psx_prof_scopes
+{
+	/** Waiting for the GPU to accept a new primitive list (GsDrawList(), GsListSubmit()) */
+	PROF_GPU_LIST = 0,
+	/** Waiting for the GPU to finish drawing, in the libpsx functions which do (not GsIsDrawing() itself) */
+	PROF_GPU_DRAW = 1,
+	/** Waiting for image transfers to Video RAM (LoadImage()) */
+	PROF_IMAGE = 2,
+};
+
+/**
+ * Sets up root counters 1 and 2 and enables the profiler.
+ * Scopes registered before are kept, their times are cleared.
+ */
+
+void PSX_ProfInit(void);
+
+/**
+ * Disables the profiler. PSX_ProfBegin() and PSX_ProfEnd() do nothing
+ * until PSX_ProfInit() is called again.
+ */
+
+void PSX_ProfStop(void);
+
+/**
+ * Registers a named scope, or finds the one already registered with the same name.
+ * @param name Name of the scope; the string is not copied and has to stay valid
+ * @return Scope identifier, -1 if there are already PROF_MAX_SCOPES scopes
+ */
+
+int PSX_ProfScope(const char *name);
+
+/**
+ * Starts timing a scope. Does nothing if the scope is already being timed,
+ * so a scope entered recursively is counted once.
+ * Different scopes can be nested, each one counts the full time spent in it.
+ * @param scope Scope identifier
+ */
+
+void PSX_ProfBegin(int scope);
+
+/**
+ * Stops timing a scope, adding the time spent in it to the total of the current frame.
+ * @param scope Scope identifier
+ */
+
+void PSX_ProfEnd(int scope);
+
+/**
+ * Ends the current frame: the total of each scope and the length of the frame
+ * are stored in the history ring buffer, and new totals are started.
+ * Scopes still being timed are split between the two frames.
+ * Call it once per frame, for example right after waiting for vertical blank.
+ */
+
+void PSX_ProfFrame(void);
+
+/**
+ * Gets the time spent in a scope during one of the frames in the history.
+ * @param scope Scope identifier, -1 for the length of the whole frame
+ * @param frame 0 for the last frame ended by PSX_ProfFrame(), 1 for the one before it,
+ *              up to PROF_HISTORY - 1
+ * @return Time in root counter ticks, 0 if the frame is not in the history
+ */
+
+unsigned int PSX_ProfGetTicks(int scope, int frame);
+
+/**
+ * Converts root counter ticks to microseconds.
+ * @param ticks Time in root counter ticks
+ * @return Time in microseconds
+ */
+
+unsigned int PSX_ProfTicksToUs(unsigned int ticks);
+
+/**
+ * Prints the average and maximum time of each scope over the frames
+ * in the history using sio_printf().
+ */
+
+void PSX_ProfDump(void);
+
+/**
+ * Adds one bar for each scope to the primitive list, showing the time it took in the last
+ * frame, with its name and the time in milliseconds printed with GsPrintFont().
+ * The first bar is the length of the whole frame.
+ * A full bar is the length of a video frame (1/60 s, or 1/50 s in PAL mode),
+ * a bar longer than that is drawn in red.
+ * The font has to be loaded with GsLoadFont().
+ * @param x X coordinate of the top left corner
+ * @param y Y coordinate of the top left corner
+ * @param w Width of the bars; names take 72 more pixels on the left, times 56 on the right
+ */
+
+void PSX_ProfDraw(int x, int y, int w);
+
+#endif
@@ -64,6 +64,16 @@ typedef struct
     unsigned int size;
      /** Used internally by fopen(), 0 if free, 1 if occupied */
     unsigned int used;
+     /** Read-ahead buffer of CD-ROM files, allocated by the first fread() */
+    unsigned char *cache;
+     /** File position of the first byte in the read-ahead buffer */
+    unsigned int cache_pos;
+     /** Number of valid bytes in the read-ahead buffer */
+    unsigned int cache_len;
+     /** Number of fread() calls served from the read-ahead buffer without reading the CD */
+    unsigned int cache_hits;
+     /** Number of reads from the CD made by fread() */
+    unsigned int cache_reads;
 }FILE;
 
 /*
@@ -0,0 +1,102 @@
+/*
+ * arena.c
+ *
+ * PSXSDK arena and pool allocators
+ */
+
+#include <psx.h>
+#include <stdio.h>
+
+#define ARENA_ALIGN		8
+
+void PSX_ArenaInit(psx_arena *arena, void *buffer, unsigned int size)
+{
+	arena->base = (unsigned char*)buffer;
+	arena->size = size;
+	arena->pos = 0;
+	arena->high_water = 0;
+}
+
+void *PSX_ArenaAlloc(psx_arena *arena, unsigned int size)
+{
+	unsigned int pos = arena->pos;
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	if(size > (arena->size - pos))
+		return NULL;
+
+	arena->pos = pos + size;
+
+	if(arena->pos > arena->high_water)
+		arena->high_water = arena->pos;
+
+	return arena->base + pos;
+}
+
+void PSX_ArenaReset(psx_arena *arena)
+{
+	arena->pos = 0;
+}
+
+unsigned int PSX_ArenaMark(psx_arena *arena)
+{
+	return arena->pos;
+}
+
+void PSX_ArenaRelease(psx_arena *arena, unsigned int mark)
+{
+	if(mark < arena->pos)
+		arena->pos = mark;
+}
+
+unsigned int PSX_PoolInit(psx_pool *pool, void *buffer, unsigned int size, unsigned int obj_size)
+{
+	unsigned char *p = (unsigned char*)buffer;
+	unsigned int x;
+
+	// Free objects hold the pointer to the next free one.
+	if(obj_size < sizeof(void*))
+		obj_size = sizeof(void*);
+
+	obj_size = (obj_size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	pool->obj_size = obj_size;
+	pool->count = size / obj_size;
+	pool->used = 0;
+	pool->free_list = NULL;
+
+	// Link the objects so that they are handed out in address order.
+	for(x = pool->count; x > 0; x--)
+	{
+		void **obj = (void**)(p + ((x - 1) * obj_size));
+
+		*obj = pool->free_list;
+		pool->free_list = obj;
+	}
+
+	return pool->count;
+}
+
+void *PSX_PoolAlloc(psx_pool *pool)
+{
+	void **obj = (void**)pool->free_list;
+
+	if(obj == NULL)
+		return NULL;
+
+	pool->free_list = *obj;
+	pool->used++;
+
+	return obj;
+}
+
+void PSX_PoolFree(psx_pool *pool, void *ptr)
+{
+	if(ptr == NULL)
+		return;
+
+	*(void**)ptr = pool->free_list;
+	pool->free_list = ptr;
+	pool->used--;
+}
@@ -0,0 +1,287 @@
+/*
+ * cdindex.c
+ *
+ * Index of the long file names on the CD-ROM, used by the cdromL: device of fopen()
+ *
+ * Every TRANS.TBL on the disc is read once, when the first cdromL: file is opened
+ * or when CdIndexBuild() is called, and each long path is stored in a hash table
+ * with the ISO9660 name of the file, so that opening a file does not need to read
+ * any TRANS.TBL again.
+ */
+
+#include <psx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define CDINDEX_BUCKETS     256
+#define CDINDEX_PATH_MAX    256
+#define CDINDEX_MAX_DEPTH   8
+
+typedef struct cdindex_entry
+{
+    /** Next entry in the same bucket */
+    struct cdindex_entry *next;
+    unsigned int hash;
+    /** Size in bytes, -1 until the file is opened the first time */
+    int size;
+    /** Long path, in lower case and separated by '/' */
+    char *long_name;
+    /** Name to pass to open(), e.g. cdrom:\DATA\LEVEL1.DAT;1 */
+    char *iso_name;
+}cdindex_entry;
+
+static cdindex_entry *cdindex_buckets[CDINDEX_BUCKETS];
+static int cdindex_count;
+static int cdindex_built;
+
+const char *libc_cdindex_find(const char *name, int **size);
+
+/*
+ * Copies a path in lower case, without leading separators and with '\' turned into '/'.
+ * Returns the length, or -1 if it doesn't fit in outl bytes.
+ */
+
+static int cdindex_normalize(const char *name, char *out, int outl)
+{
+    int x = 0;
+
+    while(*name == '/' || *name == '\\')
+        name++;
+
+    for(; *name; name++)
+    {
+        if(x >= outl - 1)
+            return -1;
+
+        if(*name == '/' || *name == '\\')
+        {
+            // Collapse repeated separators
+            if(x > 0 && out[x - 1] == '/')
+                continue;
+
+            out[x++] = '/';
+        }
+        else
+            out[x++] = tolower((unsigned char)*name);
+    }
+
+    out[x] = 0;
+
+    return x;
+}
+
+// FNV-1a
+
+static unsigned int cdindex_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while(*s)
+        h = (h ^ (unsigned char)*(s++)) * 16777619u;
+
+    return h;
+}
+
+static int cdindex_add(const char *long_name, const char *iso_name)
+{
+    int ll = strlen(long_name) + 1;
+    int il = strlen(iso_name) + 1;
+    cdindex_entry *e = malloc(sizeof(cdindex_entry) + ll + il);
+
+    if(e == NULL)
+        return 0;
+
+    e->long_name = (char*)(e + 1);
+    e->iso_name = e->long_name + ll;
+    memcpy(e->long_name, long_name, ll);
+    memcpy(e->iso_name, iso_name, il);
+
+    e->hash = cdindex_hash(long_name);
+    e->size = -1;
+    e->next = cdindex_buckets[e->hash % CDINDEX_BUCKETS];
+    cdindex_buckets[e->hash % CDINDEX_BUCKETS] = e;
+    cdindex_count++;
+
+    return 1;
+}
+
+static int cdindex_is_space(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+/*
+ * Adds the files listed by the TRANS.TBL of a directory, then scans its subdirectories.
+ * iso_dir is the ISO9660 path of the directory, ending with '\',
+ * long_dir the long path of the directory, empty or ending with '/'.
+ * Returns 0 if the TRANS.TBL of the directory could not be read.
+ */
+
+static int cdindex_scan(const char *iso_dir, const char *long_dir, int depth)
+{
+    char iso_name[CDINDEX_PATH_MAX];
+    char long_name[CDINDEX_PATH_MAX];
+    char *tbl, *org, *name, *end;
+    char type;
+    FILE *f;
+    int s;
+
+    if(strlen(iso_dir) + sizeof("TRANS.TBL;1") > CDINDEX_PATH_MAX)
+        return 0;
+
+    strcpy(iso_name, iso_dir);
+    strcat(iso_name, "TRANS.TBL;1");
+
+    f = fopen(iso_name, "rb");
+
+    if(f == NULL)
+    {
+        dprintf("Couldn't find %s\n", iso_name);
+        return 0;
+    }
+
+    s = f->size;
+    tbl = malloc(s + 1);
+
+    if(tbl == NULL)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    fread(tbl, 1, s, f);
+    fclose(f);
+    tbl[s] = 0;
+
+    // Each line is: type, ISO9660 name, long name
+    for(end = tbl; *end; )
+    {
+        while(cdindex_is_space(*end))
+            end++;
+
+        if(*end == 0)
+            break;
+
+        type = *(end++);
+
+        while(*end == ' ' || *end == '\t')
+            end++;
+
+        for(org = end; *end && !cdindex_is_space(*end); end++);
+
+        if(*end)
+            *(end++) = 0;
+
+        while(*end == ' ' || *end == '\t')
+            end++;
+
+        for(name = end; *end && *end != '\n' && *end != '\r'; end++);
+
+        if(*end)
+            *(end++) = 0;
+
+        // Drop trailing blanks from the long name
+        for(s = strlen(name); s > 0 && cdindex_is_space(name[s - 1]); s--)
+            name[s - 1] = 0;
+
+        if(*org == 0 || *name == 0)
+            continue;
+
+        if(strlen(iso_dir) + strlen(org) + 2 > CDINDEX_PATH_MAX ||
+            strlen(long_dir) + strlen(name) + 2 > CDINDEX_PATH_MAX)
+            continue;
+
+        strcpy(iso_name, iso_dir);
+        strcat(iso_name, org);
+        strcpy(long_name, long_dir);
+        strcat(long_name, name);
+
+        if(cdindex_normalize(long_name, long_name, CDINDEX_PATH_MAX) < 0)
+            continue;
+
+        if(type == 'F')
+        {
+            cdindex_add(long_name, iso_name);
+        }
+        else if(type == 'D' && depth < CDINDEX_MAX_DEPTH)
+        {
+            strcat(iso_name, "\\");
+            strcat(long_name, "/");
+
+            cdindex_scan(iso_name, long_name, depth + 1);
+        }
+    }
+
+    free(tbl);
+
+    return 1;
+}
+
+void CdIndexFree(void)
+{
+    cdindex_entry *e, *next;
+    int x;
+
+    for(x = 0; x < CDINDEX_BUCKETS; x++)
+    {
+        for(e = cdindex_buckets[x]; e != NULL; e = next)
+        {
+            next = e->next;
+            free(e);
+        }
+
+        cdindex_buckets[x] = NULL;
+    }
+
+    cdindex_count = 0;
+    cdindex_built = 0;
+}
+
+int CdIndexBuild(void)
+{
+    CdIndexFree();
+
+    // Remember a failed scan too, so that every fopen() doesn't read the disc again
+    cdindex_built = 1;
+
+    if(!cdindex_scan("cdrom:\\", "", 0))
+        return -1;
+
+    return cdindex_count;
+}
+
+/*
+ * Looks up the long path of a file, building the index first if needed.
+ * Returns the ISO9660 name of the file, or NULL if it is not on the disc.
+ * *size points to the cached size of the file, -1 if not known yet.
+ */
+
+const char *libc_cdindex_find(const char *name, int **size)
+{
+    char key[CDINDEX_PATH_MAX];
+    cdindex_entry *e;
+    unsigned int h;
+
+    if(!cdindex_built)
+        CdIndexBuild();
+
+    if(cdindex_normalize(name, key, CDINDEX_PATH_MAX) < 0)
+        return NULL;
+
+    h = cdindex_hash(key);
+
+    for(e = cdindex_buckets[h % CDINDEX_BUCKETS]; e != NULL; e = e->next)
+    {
+        if(e->hash == h && strcmp(e->long_name, key) == 0)
+        {
+            *size = &e->size;
+            return e->iso_name;
+        }
+    }
+
+    dprintf("File not found: %s\n", name);
+
+    return NULL;
+}
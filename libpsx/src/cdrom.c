@@ -11,8 +11,26 @@
 #define IPENDING                *((volatile unsigned int*)0x1f801070)
 #define CDROM_HW_EVENT_ADDR     ((unsigned int)0xF0000003)
 #define CDROM_UNLIMITED_PARAMS  ((unsigned char)0xFF)
+#define DPCR                    *((volatile unsigned int*)0x1f8010f0)
+#define D3_MADR                 *((volatile unsigned int*)0x1f8010b0)
+#define D3_BCR                  *((volatile unsigned int*)0x1f8010b4)
+#define D3_CHCR                 *((volatile unsigned int*)0x1f8010b8)
+
+#define CD_SECTOR_SIZE          2048
+/* Consecutive drive errors after which a stream gives up. */
+#define CD_STREAM_MAX_RETRIES   8
+/* Busy-wait iterations in CdStreamStop() after which the drive is assumed to be stuck. */
+#define CD_STREAM_STOP_TIMEOUT  0x400000
+/* Parameter and response bytes kept for each queued command. */
+#define CD_MAX_PARAMS           8
+#define CD_MAX_RESPONSE         16
 
-static const unsigned char CdCommandParams[MaxCdl] = // 0 = single int, 1 = double int, 2,3,... = others
+/*
+ * Responses the drive sends for each command: 1 for INT3 alone, 2 for INT3 then INT2.
+ * A queued command is complete once all of them have arrived.
+ * CDROM_UNLIMITED_PARAMS marks undocumented commands, which are waited for as 1.
+ */
+static const unsigned char CdCommandParams[MaxCdl] =
 {
     [CdlSync]       = 1,
     [CdlGetstat]    = 1,
@@ -21,8 +39,8 @@ static const unsigned char CdCommandParams[MaxCdl] = // 0 = single int, 1 = doub
     [CdlForward]    = 1,
     [CdlBackward]   = 1,
     [CdlReadN]      = 1,
-    [CdlStandby]    = 1,
-    [CdlStop]       = 1,
+    [CdlStandby]    = 2,
+    [CdlStop]       = 2,
     [CdlPause]      = 2,
     [CdlInit]       = 2,
     [CdlMute]       = 1,
@@ -47,14 +65,81 @@ static const unsigned char CdCommandParams[MaxCdl] = // 0 = single int, 1 = doub
     [CdlReadTOC]    = 2
 };
 
+/* Stream states. The drive answers each command with INT3, Pause with INT3 then INT2,
+ * and every sector read with INT1; INT5 reports an error. */
+enum
+{
+    CDS_IDLE,
+    CDS_SETMODE,        /* Setmode sent */
+    CDS_SETLOC,         /* Setloc sent */
+    CDS_READ,           /* ReadN or ReadS sent */
+    CDS_READING,        /* Receiving sectors */
+    CDS_PAUSE_FULL,     /* Pause sent because the ring buffer is full */
+    CDS_PAUSED,
+    CDS_PAUSE_END,      /* Pause sent after the last sector */
+    CDS_PAUSE_STOP,     /* Pause sent by CdStreamStop() */
+    CDS_DONE,
+    CDS_ERROR
+};
+
+/* A command queued by CdCommandAsync(). */
+typedef struct
+{
+    unsigned char cmd;
+    unsigned char num;
+    unsigned char params[CD_MAX_PARAMS];
+    /* Responses still expected: INT3, then INT2 for some commands. */
+    unsigned char pending;
+    unsigned char error;
+    unsigned char *result;
+    int max;
+    int count;
+    CdCommandCallback callback;
+}cd_command;
+
 volatile int cdrom_handler_event_id;
 volatile unsigned char cdrom_last_command;
-volatile unsigned char cdrom_command_stat[2];
 volatile int cdrom_command_direct;
 
+/* The command in progress is cd_queue_head, the next one queued gets cd_queue_tail. */
+static cd_command cd_queue[CD_QUEUE_SIZE];
+static volatile unsigned int cd_queue_head;
+static volatile unsigned int cd_queue_tail;
+static int cd_queue_ready;
+static int cd_in_irq;
+static volatile unsigned char cd_last_status;
+
+/* Results of the last CdSendCommand(), returned by CdReadResults(). */
+static unsigned char cd_sync_result[CD_MAX_RESPONSE];
+static int cd_sync_count;
+
+static volatile int cd_stream_state;
+static volatile int cd_stream_stop_req;
+static unsigned char *cd_stream_buffer;
+static unsigned int cd_stream_slots;
+static volatile unsigned int cd_stream_write;
+static volatile unsigned int cd_stream_read;
+static unsigned int cd_stream_lba;
+static unsigned int cd_stream_remaining;
+static int cd_stream_endless;
+static unsigned char cd_stream_mode;
+static unsigned char cd_stream_read_cmd;
+static int cd_stream_retries;
+static CdStreamStats cd_stream_stats;
+
 static void CdSetIndex(const unsigned char index);
+static void CdAcknowledgeInterrupts(void);
 int* _internal_cdrom_handler(void);
 void cdrom_handler_callback(void);
+static void cd_send_command(const enum tCdCmd eCmd, const unsigned char *params, const int num);
+static void cd_take_drive(void);
+static void cd_queue_issue(void);
+static void cd_queue_irq(const enum tCdInt eCdInt, const unsigned char *response, const int n);
+static int cd_stream_active(void);
+static void cd_stream_irq(const enum tCdInt eCdInt);
+static void cd_stream_setloc(void);
+static void cd_stream_sector(void);
+static void cd_stream_finish(const int state);
 
 enum tCdInt CdGetInterrupt(void)
 {
@@ -69,9 +154,159 @@ enum tCdInt CdGetInterrupt(void)
     return eCdInt;
 }
 
+/*
+ * Called by _internal_cdrom_handler (cdromh.s) on CD-ROM interrupts while
+ * cdrom_command_direct is set, that is while queued commands or a stream
+ * own the drive. The response goes to the stream if one is active,
+ * to the command in progress otherwise.
+ */
+
 void cdrom_handler_callback(void)
 {
+    enum tCdInt eCdInt;
+    unsigned char response[CD_MAX_RESPONSE];
+    unsigned char b;
+    int n = 0;
+
+    CdSetIndex(1);
+    eCdInt = (enum tCdInt)(CDREG(3) & INT_MASK);
+
+    /* Read the response FIFO, then acknowledge the interrupt. */
+    while (CDREG(0) & 0x20)
+    {
+        b = CDREG(1);
+
+        if (n < CD_MAX_RESPONSE)
+            response[n++] = b;
+    }
+
+    CdAcknowledgeInterrupts();
+
+    if (eCdInt == CD_NOINT)
+        return;
+
+    /* The first response byte is always the drive status. */
+    if (n > 0)
+        cd_last_status = response[0];
 
+    cd_in_irq = 1;
+
+    if (cd_stream_active())
+        cd_stream_irq(eCdInt);
+    else
+        cd_queue_irq(eCdInt, response, n);
+
+    cd_in_irq = 0;
+}
+
+static void cd_stream_irq(const enum tCdInt eCdInt)
+{
+    int state = cd_stream_state;
+
+    if (eCdInt == CD_INT5)
+    {
+        cd_stream_stats.errors++;
+
+        if (state == CDS_PAUSE_END || state == CDS_PAUSE_STOP)
+        {
+            cd_stream_finish((state == CDS_PAUSE_END) ? CDS_DONE : CDS_IDLE);
+        }
+        else if (++cd_stream_retries > CD_STREAM_MAX_RETRIES)
+        {
+            cd_stream_finish(CDS_ERROR);
+        }
+        else
+        {
+            /* Seek again to the first sector not received yet. */
+            cd_stream_stats.restarts++;
+            cd_stream_setloc();
+        }
+
+        return;
+    }
+
+    /* CdStreamStop() waits for the command in progress to be answered. */
+    if (cd_stream_stop_req && state >= CDS_SETMODE && state <= CDS_READING)
+    {
+        if (eCdInt == CD_INT1)
+        {
+            /* Drop the sector. */
+            CdSetIndex(0);
+            CDREG(3) = 0;
+        }
+
+        cd_stream_stop_req = 0;
+        cd_send_command(CdlPause, NULL, 0);
+        cd_stream_state = CDS_PAUSE_STOP;
+        return;
+    }
+
+    switch (state)
+    {
+        case CDS_SETMODE:
+            if (eCdInt == CD_INT3)
+                cd_stream_setloc();
+        break;
+
+        case CDS_SETLOC:
+            if (eCdInt == CD_INT3)
+            {
+                cd_send_command(cd_stream_read_cmd, NULL, 0);
+                cd_stream_state = CDS_READ;
+            }
+        break;
+
+        case CDS_READ:
+            if (eCdInt == CD_INT3)
+            {
+                cd_stream_state = CDS_READING;
+                break;
+            }
+            /* Fall through */
+
+        case CDS_READING:
+            if (eCdInt != CD_INT1)
+                break;
+
+            cd_stream_state = CDS_READING;
+            cd_stream_sector();
+
+            if (!cd_stream_endless && cd_stream_remaining == 0)
+            {
+                cd_send_command(CdlPause, NULL, 0);
+                cd_stream_state = CDS_PAUSE_END;
+            }
+            else if ((cd_stream_write - cd_stream_read) >= cd_stream_slots)
+            {
+                cd_send_command(CdlPause, NULL, 0);
+                cd_stream_state = CDS_PAUSE_FULL;
+            }
+        break;
+
+        case CDS_PAUSE_FULL:
+        case CDS_PAUSE_END:
+        case CDS_PAUSE_STOP:
+            if (eCdInt == CD_INT1)
+            {
+                /* The drive keeps reading until the pause takes effect. */
+                cd_stream_sector();
+            }
+            else if (eCdInt == CD_INT2)
+            {
+                if (state == CDS_PAUSE_END)
+                    cd_stream_finish(CDS_DONE);
+                else if (state == CDS_PAUSE_STOP)
+                    cd_stream_finish(CDS_IDLE);
+                else if ((cd_stream_slots - (cd_stream_write - cd_stream_read)) >= ((cd_stream_slots + 1) / 2))
+                    cd_stream_setloc(); /* Half of the ring was freed meanwhile. */
+                else
+                    cd_stream_state = CDS_PAUSED;
+            }
+        break;
+
+        default:
+        break;
+    }
 }
 
 
@@ -92,77 +327,31 @@ static void CdAcknowledgeInterrupts(void)
 
 void CdSendCommand(const enum tCdCmd eCmd, const size_t num, ...)
 {
-#if 0
+    unsigned char params[CD_MAX_PARAMS];
     va_list ap;
+    size_t i;
+    int id;
 
     /* Initialize variable-argument list. */
     va_start(ap, num);
 
-    /* Acknowledge previous CD-ROM interrupts. */
-    CdAcknowledgeInterrupts();
-
-    /* Set index 0 on index/status CD-ROM register
-     * so command parameters and command byte are sent. */
-    CdSetIndex(0);
-
-    {
-        enum
-        {
-            COMMAND_PARAMETER_BUSY_BIT = 1 << 7
-        };
-
-        size_t i;
-
-        for (i = 0; i < num; i++)
-        {
-            enum
-            {
-                PARAMETER_FIFO_FULL_BIT = 1 << 4
-            };
-
-            /* Wait until parameter FIFO is empty and
-             * parameter/command busy flag is cleared. */
-            while ( (CDREG(0) & PARAMETER_FIFO_FULL_BIT)
-                                ||
-                    (CDREG(0) & COMMAND_PARAMETER_BUSY_BIT) );
-
-            /* Send command parameters. */
-            CDREG(2) = (unsigned char)va_arg(ap, unsigned int);
-        }
+    for (i = 0; i < num && i < CD_MAX_PARAMS; i++)
+        params[i] = (unsigned char)va_arg(ap, unsigned int);
 
-        /* Wait until parameter/command busy flag is cleared. */
-        while (CDREG(0) & COMMAND_PARAMETER_BUSY_BIT);
-    }
-
-    /* Send command. */
-    CDREG(1) = (unsigned char)eCmd;
+    /* De-initialize variable-argument list. */
+    va_end(ap);
 
-    {
-        size_t i;
+    cd_sync_count = 0;
 
-        /* Depending on the number of INTs we expect for a command,
-         * we wait for an INT to occur, we store the response data returned,
-         * and we flush the INT. */
-        for(i = 0; i < CdCommandParams[eCmd]; i++)
-        {
-            /* Set index 1 on index/status CD-ROM register
-             * so that command results can be read. */
-            CdSetIndex(1);
+    id = CdCommandAsync(eCmd, params, i, cd_sync_result, CD_MAX_RESPONSE, NULL);
 
-            /* Read status from CD-ROM command. */
-            cdrom_command_stat[i] = CDREG(1);
+    if (id < 0)
+        return;
 
-            /* Acknowledge CD-ROM interrupts. */
-            CdAcknowledgeInterrupts();
-        }
-    }
+    CdCommandWait(id);
 
-    /* Store ID number of last executed command. */
-    cdrom_last_command = eCmd;
-
-    /* De-initialize variable-argument list. */
-    va_end(ap);
-#endif
+    /* Results are kept on errors too: the second byte is the error code. */
+    cd_sync_count = cd_queue[id % CD_QUEUE_SIZE].count;
 }
 
 static void CdSetIndex(const unsigned char index)
@@ -184,35 +373,12 @@ static void CdSetIndex(const unsigned char index)
 
 int CdReadResults(unsigned char *out, int max)
 {
-#if 0
     int x;
-    unsigned char *outo = out;
-    unsigned char b;
 
-    for(x = 0; x < CdCommandParams[cdrom_last_command]; x++)
-    {
-        if(max > 0)
-        {
-            *(out++) = cdrom_command_stat[x];
-            max--;
-        }
-    }
-
-    CDREG(0) = 1;
+    for (x = 0; x < cd_sync_count && x < max; x++)
+        out[x] = cd_sync_result[x];
 
-    while(CDREG(0) & 0x20)
-    {
-        b = CDREG(1);
-        if(max>0)
-        {
-            *(out++) = b;
-            max--;
-        }
-    }
-
-    return (out - outo);
-#endif
-    return 0;
+    return x;
 }
 
 void _internal_cdromlib_init()
@@ -244,12 +410,16 @@ void _internal_cdromlib_init()
         EnableEvent(eventID);
     }
 #endif
+
+    /* Commands can be queued once the interrupt handler is installed. */
+    cd_queue_ready = 1;
+
     ExitCriticalSection(); // Enable IRQs
 }
 
 int CdGetStatus(void)
 {
-    unsigned char out;
+    unsigned char out = 0;
 
     CdSendCommand(CdlGetstat, 0);
     CdReadResults(&out, 1);
@@ -276,23 +446,446 @@ int CdPlayTrack(unsigned int track)
         DOUBLE_SPEED    = 1 << 7,
     };
 
-    while(CdGetStatus() & CDSTATUS_SEEK);
-
-    CdSendCommand(CdlSetmode, 1, (unsigned int)(CDDA | AUTOPAUSE | IGNORE_BIT | DOUBLE_SPEED));
-    CdSendCommand(CdlPlay, 1, ((track / 10) << 4) | (track % 10));
+    unsigned char mode = CDDA | AUTOPAUSE | IGNORE_BIT | DOUBLE_SPEED;
+    unsigned char bcd = ((track / 10) << 4) | (track % 10);
 
-    while (!(CdGetStatus() & CDSTATUS_PLAY));
+    /* The queue sends Play once Setmode is answered, so there is no
+     * need to wait for the drive here. */
+    if (CdCommandAsync(CdlSetmode, &mode, 1, NULL, 0, NULL) < 0)
+        return 0;
 
-    return 1;
+    return (CdCommandAsync(CdlPlay, &bcd, 1, NULL, 0, NULL) >= 0);
 }
 
 unsigned char CdRamRead(unsigned short addr)
 {
-    unsigned char b;
+    unsigned char b = 0;
     addr &= 0x3ff;
 
-    CdSendCommand(0x19, 0x60, addr&0xff, addr >> 8);
+    CdSendCommand(CdlTest, 3, 0x60, addr&0xff, addr >> 8);
     CdReadResults(&b, 1);
 
     return b;
 }
+
+/* *************************************
+ * Command queue
+ * *************************************/
+
+/*
+ * Sends a command without waiting for its response; the response is
+ * handled by cdrom_handler_callback().
+ */
+
+static void cd_send_command(const enum tCdCmd eCmd, const unsigned char *params, const int num)
+{
+    enum
+    {
+        COMMAND_PARAMETER_BUSY_BIT = 1 << 7
+    };
+
+    int i;
+
+    CdSetIndex(0);
+
+    while (CDREG(0) & COMMAND_PARAMETER_BUSY_BIT);
+
+    for (i = 0; i < num; i++)
+        CDREG(2) = params[i];
+
+    CDREG(1) = (unsigned char)eCmd;
+    cdrom_last_command = eCmd;
+}
+
+/*
+ * Routes the CD-ROM interrupts to cdrom_handler_callback() instead of the BIOS.
+ */
+
+static void cd_take_drive(void)
+{
+    IMASK |= 1 << 2;
+
+    /* Enable all the CD-ROM interrupts and drop the ones left by the BIOS. */
+    CdSetIndex(1);
+    CDREG(2) = 0x1F;
+    CdAcknowledgeInterrupts();
+
+    cdrom_command_direct = 1;
+}
+
+static void cd_queue_issue(void)
+{
+    cd_command *c = &cd_queue[cd_queue_head % CD_QUEUE_SIZE];
+
+    cd_send_command(c->cmd, c->params, c->num);
+}
+
+static void cd_queue_irq(const enum tCdInt eCdInt, const unsigned char *response, const int n)
+{
+    cd_command *c;
+    unsigned int id;
+    int x;
+
+    if (eCdInt == CD_INT1)
+    {
+        /* Sectors read outside of a stream, and audio reports, are dropped. */
+        CdSetIndex(0);
+        CDREG(3) = 0;
+        return;
+    }
+
+    if (cd_queue_head == cd_queue_tail || (eCdInt != CD_INT2 && eCdInt != CD_INT3 && eCdInt != CD_INT5))
+        return;
+
+    id = cd_queue_head;
+    c = &cd_queue[id % CD_QUEUE_SIZE];
+
+    for (x = 0; x < n && c->count < c->max; x++)
+        c->result[c->count++] = response[x];
+
+    if (eCdInt == CD_INT5)
+        c->error = 1;
+    else if (--c->pending > 0)
+        return;
+
+    /* Done: the callback can queue more commands, sent below. */
+    cd_queue_head = id + 1;
+
+    if (c->callback != NULL)
+        c->callback(id, c->error, c->result, c->count);
+
+    if (cd_queue_head != cd_queue_tail)
+        cd_queue_issue();
+    else
+        cdrom_command_direct = 0;
+}
+
+int CdCommandAsync(const enum tCdCmd eCmd, const unsigned char *params, int num, unsigned char *result, int max, CdCommandCallback callback)
+{
+    cd_command *c;
+    unsigned int id;
+    int x;
+
+    if (!cd_queue_ready || num < 0 || num > CD_MAX_PARAMS || eCmd >= MaxCdl)
+        return -1;
+
+    if (!cd_in_irq)
+        EnterCriticalSection();
+
+    id = cd_queue_tail;
+
+    if ((id - cd_queue_head) >= CD_QUEUE_SIZE || cd_stream_active())
+    {
+        if (!cd_in_irq)
+            ExitCriticalSection();
+
+        return -1;
+    }
+
+    c = &cd_queue[id % CD_QUEUE_SIZE];
+    c->cmd = eCmd;
+    c->num = num;
+
+    for (x = 0; x < num; x++)
+        c->params[x] = params[x];
+
+    c->pending = CdCommandParams[eCmd];
+
+    if (c->pending == 0 || c->pending == CDROM_UNLIMITED_PARAMS)
+        c->pending = 1;
+
+    c->error = 0;
+    c->result = result;
+    c->max = (result != NULL) ? max : 0;
+    c->count = 0;
+    c->callback = callback;
+
+    cd_queue_tail = id + 1;
+
+    /* From the interrupt handler, the command is sent once the current one is done. */
+    if (!cd_in_irq)
+    {
+        if (id == cd_queue_head)
+        {
+            cd_take_drive();
+            cd_queue_issue();
+        }
+
+        ExitCriticalSection();
+    }
+
+    return id;
+}
+
+int CdCommandDone(int id)
+{
+    return (int)(cd_queue_head - (unsigned int)id) > 0;
+}
+
+int CdCommandWait(int id)
+{
+    cd_command *c = &cd_queue[id % CD_QUEUE_SIZE];
+
+    while (!CdCommandDone(id));
+
+    return c->error ? -1 : c->count;
+}
+
+void CdCommandWaitAll(void)
+{
+    while (cd_queue_head != cd_queue_tail);
+}
+
+int CdLastStatus(void)
+{
+    return cd_last_status;
+}
+
+/* *************************************
+ * Streaming reads
+ * *************************************/
+
+/*
+ * Seeks to the next sector of the stream. The read command is sent
+ * when the drive answers.
+ */
+
+static void cd_stream_setloc(void)
+{
+    unsigned int lba = cd_stream_lba + 150;
+    unsigned char msf[3];
+
+    msf[0] = lba / (75 * 60);
+    msf[1] = (lba / 75) % 60;
+    msf[2] = lba % 75;
+
+    /* Minute, second and frame are sent in BCD. */
+    msf[0] = ((msf[0] / 10) << 4) | (msf[0] % 10);
+    msf[1] = ((msf[1] / 10) << 4) | (msf[1] % 10);
+    msf[2] = ((msf[2] / 10) << 4) | (msf[2] % 10);
+
+    cd_send_command(CdlSetloc, msf, 3);
+    cd_stream_state = CDS_SETLOC;
+}
+
+static int cd_stream_active(void)
+{
+    return (cd_stream_state >= CDS_SETMODE && cd_stream_state <= CDS_PAUSE_STOP);
+}
+
+/*
+ * Moves the sector the drive has just read into the ring buffer using DMA channel 3,
+ * or drops it if the ring buffer is full or all the sectors were received.
+ */
+
+static void cd_stream_sector(void)
+{
+    enum
+    {
+        WANT_DATA_BIT = 1 << 7,
+        DATA_FIFO_NOT_EMPTY_BIT = 1 << 6
+    };
+
+    CdSetIndex(0);
+
+    if ((cd_stream_write - cd_stream_read) >= cd_stream_slots
+        || (!cd_stream_endless && cd_stream_remaining == 0))
+    {
+        /* Reset the data FIFO; the sector is read again when the stream resumes. */
+        CDREG(3) = 0;
+        cd_stream_stats.overruns++;
+        return;
+    }
+
+    CDREG(3) = WANT_DATA_BIT;
+
+    while (!(CDREG(0) & DATA_FIFO_NOT_EMPTY_BIT));
+
+    D3_MADR = (unsigned int)(cd_stream_buffer + ((cd_stream_write % cd_stream_slots) * CD_SECTOR_SIZE));
+    D3_BCR = (CD_SECTOR_SIZE / 4) | (1 << 16);
+    D3_CHCR = 0x11000000;
+
+    while (D3_CHCR & (1 << 24));
+
+    CDREG(3) = 0;
+
+    cd_stream_write++;
+    cd_stream_lba++;
+    cd_stream_retries = 0;
+    cd_stream_stats.sectors++;
+
+    if (!cd_stream_endless)
+        cd_stream_remaining--;
+}
+
+/*
+ * Ends the stream and gives the drive back to the BIOS.
+ */
+
+static void cd_stream_finish(const int state)
+{
+    cd_stream_state = state;
+    cd_stream_stop_req = 0;
+    cdrom_command_direct = 0;
+}
+
+int CdStreamStart(unsigned int lba, unsigned int sectors, void *buffer, unsigned int ring_sectors, int flags)
+{
+    enum
+    {
+        DOUBLE_SPEED = 1 << 7,
+        DMA3_ENABLE = 1 << 15
+    };
+
+    if (buffer == NULL || ring_sectors == 0 || (((unsigned int)buffer) & 3))
+        return 0;
+
+    CdStreamStop();
+
+    /* Let the queued commands complete first. */
+    CdCommandWaitAll();
+
+    EnterCriticalSection();
+
+    cd_stream_buffer = buffer;
+    cd_stream_slots = ring_sectors;
+    cd_stream_write = 0;
+    cd_stream_read = 0;
+    cd_stream_lba = lba;
+    cd_stream_remaining = sectors;
+    cd_stream_endless = (sectors == 0);
+    cd_stream_retries = 0;
+    cd_stream_stop_req = 0;
+    cd_stream_mode = (flags & CD_STREAM_SPEED1) ? 0 : DOUBLE_SPEED;
+    cd_stream_read_cmd = (flags & CD_STREAM_REALTIME) ? CdlReadS : CdlReadN;
+
+    cd_stream_stats.sectors = 0;
+    cd_stream_stats.overruns = 0;
+    cd_stream_stats.restarts = 0;
+    cd_stream_stats.errors = 0;
+
+    DPCR |= DMA3_ENABLE;
+
+    cd_take_drive();
+    cd_send_command(CdlSetmode, &cd_stream_mode, 1);
+    cd_stream_state = CDS_SETMODE;
+
+    ExitCriticalSection();
+
+    return 1;
+}
+
+void *CdStreamGetSector(void)
+{
+    if (cd_stream_write == cd_stream_read)
+        return NULL;
+
+    return cd_stream_buffer + ((cd_stream_read % cd_stream_slots) * CD_SECTOR_SIZE);
+}
+
+void CdStreamReleaseSector(void)
+{
+    if (cd_stream_write == cd_stream_read)
+        return;
+
+    cd_stream_read++;
+
+    /* Resume once half of the ring buffer is free, so that the drive
+     * does not have to seek back after every sector. */
+    if (cd_stream_state == CDS_PAUSED
+        && (cd_stream_slots - (cd_stream_write - cd_stream_read)) >= ((cd_stream_slots + 1) / 2))
+    {
+        EnterCriticalSection();
+
+        if (cd_stream_state == CDS_PAUSED)
+        {
+            cd_stream_stats.restarts++;
+            cd_stream_setloc();
+        }
+
+        ExitCriticalSection();
+    }
+}
+
+int CdStreamGetStatus(void)
+{
+    switch (cd_stream_state)
+    {
+        case CDS_IDLE:
+            return CD_STREAM_IDLE;
+
+        case CDS_PAUSED:
+        case CDS_PAUSE_FULL:
+            return CD_STREAM_PAUSED;
+
+        case CDS_PAUSE_END:
+        case CDS_DONE:
+            return (cd_stream_write == cd_stream_read) ? CD_STREAM_DONE : CD_STREAM_READING;
+
+        case CDS_ERROR:
+            return CD_STREAM_ERROR;
+
+        default:
+            return CD_STREAM_READING;
+    }
+}
+
+void CdStreamGetStats(CdStreamStats *stats)
+{
+    *stats = cd_stream_stats;
+}
+
+void CdStreamStop(void)
+{
+    unsigned int timeout = CD_STREAM_STOP_TIMEOUT;
+
+    EnterCriticalSection();
+
+    switch (cd_stream_state)
+    {
+        case CDS_PAUSED:
+        case CDS_DONE:
+        case CDS_ERROR:
+            cd_stream_finish(CDS_IDLE);
+        break;
+
+        case CDS_PAUSE_FULL:
+        case CDS_PAUSE_END:
+            cd_stream_state = CDS_PAUSE_STOP;
+        break;
+
+        case CDS_IDLE:
+        case CDS_PAUSE_STOP:
+        break;
+
+        default:
+            cd_stream_stop_req = 1;
+        break;
+    }
+
+    ExitCriticalSection();
+
+    /* The interrupt handler pauses the drive, then gives it back to the BIOS. */
+    while (cd_stream_state != CDS_IDLE && --timeout);
+
+    if (timeout == 0)
+        cd_stream_finish(CDS_IDLE);
+}
+
+int CdFindFile(char *name, unsigned int *lba, unsigned int *size)
+{
+    struct DIRENTRY dirent_buf;
+
+    CdCommandWaitAll();
+
+    if (firstfile(name, &dirent_buf) != &dirent_buf)
+        return 0;
+
+    if (lba != NULL)
+        *lba = dirent_buf.head;
+
+    if (size != NULL)
+        *size = dirent_buf.size;
+
+    return 1;
+}
@@ -67,11 +67,8 @@ cdrom_check_direct_cmd:
     nop
 
 cdrom_fire_user_handler:
-    la $t0, cdrom_handler_callback
-    lw $t1, 0($t0)
-
     addiu $sp, $sp, -24
-    #jalr $t1
+    jal cdrom_handler_callback
     nop
     addiu $sp, $sp, 24
 
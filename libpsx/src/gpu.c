@@ -16,6 +16,7 @@
 #include <psx.h>
 #include <stdio.h>
 #include <strings.h>
+#include <stdint.h>
 #include "font.h"
 #include "costbl.h"
 
@@ -23,6 +24,12 @@
  * Defines
  * *************************************/
 
+/*
+ * The register definitions can be replaced from the command line, so that
+ * this file can be built on the host against stub registers (see tools/gpubench.c).
+ */
+#ifndef GPU_DATA_PORT
+
 #define GPU_DATA_PORT_ADDR          0x1f801810
 #define GPU_CONTROL_PORT_ADDR       0x1f801814
 #define GPU_DATA_PORT               *((volatile unsigned int*)GPU_DATA_PORT_ADDR)
@@ -33,12 +40,31 @@
 #define D2_BCR                  *((volatile unsigned int*)0x1f8010a4)
 #define D2_CHCR                 *((volatile unsigned int*)0x1f8010a8)
 
+#endif
+
 #define get_clutid(cx, cy)          (((cx&0x3ff)>>4)|((cy&0x1ff)<<6))
 
 /* *************************************
  * Types definition
  * *************************************/
 
+/* Primitive list state saved while a block is compiled. */
+typedef struct
+{
+    unsigned int *list;
+    unsigned int pos;
+    unsigned int *head;
+    unsigned int *tail;
+    unsigned int size;
+    unsigned int spilled;
+    unsigned int *overflow;
+    unsigned int *ot;
+    unsigned int ot_entries;
+    unsigned int draw_mode;
+    int draw_mode_valid;
+    unsigned int dropped;
+}gs_list_state;
+
 /* *************************************
  * Global variables declaration
  * *************************************/
@@ -58,7 +84,6 @@ unsigned short GsScreenH;
 unsigned char GsScreenM;
 unsigned short GsCurDrawEnvW;
 unsigned short GsCurDrawEnvH;
-double gs_vbuf[4][3];
 
 /* *************************************
  * Local variables definition
@@ -66,6 +91,22 @@ double gs_vbuf[4][3];
 
 static unsigned int *linked_list;
 static unsigned int linked_list_pos;
+static unsigned int *linked_list_head;
+static unsigned int *linked_list_tail;
+static unsigned int *gs_ot;
+static unsigned int gs_ot_entries;
+static int gs_ot_depth = -1;
+static unsigned int *gs_list_buffers[GS_LIST_MAX_BUFFERS];
+static unsigned int gs_list_count;
+static unsigned int gs_list_cur;
+static int gs_list_inflight = -1;
+static unsigned int *gs_list_primary;
+static unsigned int gs_list_primary_size;
+static unsigned int *gs_list_overflow;
+static unsigned int gs_list_overflow_size;
+static unsigned int gs_list_size;
+static unsigned int gs_list_spilled;
+static GsListStats gs_list_stats;
 static unsigned int prfont_flags;
 static int prfont_scale_x;
 static int prfont_scale_y;
@@ -74,6 +115,12 @@ static unsigned char prfont_gl = NORMAL_LUMINANCE;
 static unsigned char prfont_bl = NORMAL_LUMINANCE;
 static int __gs_autowait;
 static unsigned int draw_mode_packet;
+static unsigned int gs_draw_mode;
+static int gs_draw_mode_valid;
+static int gs_draw_mode_tracking = 1;
+static unsigned int gs_draw_offset = 0xe5000000;
+static GsBlock *gs_block;
+static gs_list_state gs_block_saved;
 static char gpu_stringbuf[512];
 
 /* *************************************
@@ -83,6 +130,27 @@ static char gpu_stringbuf[512];
 static int gs_calculate_scaled_size(const int size, const int scale);
 static unsigned int setup_attribs(unsigned char tpage, unsigned int attribute, unsigned char* packet);
 static void gs_internal_vector_rotate(int x_a, int y_a, int z_a, double *v, double *n);
+static int gs_internal_cos_fx(int a);
+static int gs_internal_sin_fx(int a);
+static void gs_list_reset(void);
+static unsigned int gs_list_room(void);
+static int gs_list_spill(void);
+static int gs_list_reserve(const unsigned int words);
+static void gs_link_chain(unsigned int *first, unsigned int *last);
+static void gs_link_packet(const unsigned int orig_pos);
+static unsigned int *gs_find_list_tail(const unsigned int pos);
+static void gs_put_draw_mode(const unsigned int header_pos, const unsigned int md);
+static void gs_track_draw_mode(const unsigned int md);
+static void gs_track_texpage(const unsigned int md);
+static int gs_font_layout(unsigned int *buf, const unsigned int size, const char *string,
+                          const int x, const int y, const int cull, const int wrap,
+                          unsigned int *last, unsigned int *end);
+static unsigned int *gs_terminate_list(void);
+static void gs_start_list_dma(const unsigned int *list_start);
+static void gs_wait_drawing(void);
+static void load_image_pio(const unsigned short *image, int x, int y, int w, int h);
+static unsigned int load_image_dma(const unsigned short *image, int x, int y, int w, int h);
+static void load_image_finish(const void *img, int w, int h, unsigned int tail);
 
 /* *************************************
  * Functions definition
@@ -134,12 +202,263 @@ static int gs_calculate_scaled_size(const int size, const int scale)
 
 void GsSetList(unsigned int *listptr)
 {
-    linked_list = listptr;
+    gs_list_primary = listptr;
+    gs_list_reset();
+}
+
+static void gs_list_reset(void)
+{
+    unsigned int used = gs_list_spilled + linked_list_pos;
+
+    if (used > gs_list_stats.high_water)
+        gs_list_stats.high_water = used;
+
+    /* Start again from the beginning of the list set by GsSetList(). */
+    linked_list = gs_list_primary;
+    gs_list_size = gs_list_primary_size;
+    gs_list_spilled = 0;
+
+    linked_list_pos = 0;
+    linked_list_head = linked_list;
+    linked_list_tail = NULL;
+    gs_draw_mode_valid = 0;
+}
+
+/*
+ * Returns how many words can still be added to the current list buffer,
+ * keeping one for the word which ends the list.
+ */
+
+static unsigned int gs_list_room(void)
+{
+    if (gs_list_size == 0)
+        return 0xffffffff;
+
+    if ((linked_list_pos + 1) >= gs_list_size)
+        return 0;
+
+    return gs_list_size - linked_list_pos - 1;
+}
+
+/*
+ * Moves on to the overflow buffer, if there is one and it is not already used.
+ * The last packet in the first buffer is linked to the start of the overflow buffer.
+ */
+
+static int gs_list_spill(void)
+{
+    unsigned int next;
+
+    if (gs_list_overflow == NULL || linked_list == gs_list_overflow)
+        return 0;
+
+    gs_list_spilled = linked_list_pos;
+    linked_list = gs_list_overflow;
     linked_list_pos = 0;
+    gs_list_size = gs_list_overflow_size;
+
+    next = ((uintptr_t)linked_list) & 0xffffff;
+
+    if (linked_list_tail != NULL)
+        *linked_list_tail = (*linked_list_tail & 0xff000000) | next;
+    else
+        linked_list_head = linked_list;
+
+    gs_list_stats.overflows++;
+
+    return 1;
+}
+
+/*
+ * Makes sure that a packet of the specified size fits in the list,
+ * moving on to the overflow buffer if needed.
+ * Returns 0, and counts the packet as dropped, if it does not fit.
+ */
+
+static int gs_list_reserve(const unsigned int words)
+{
+    if (words <= gs_list_room())
+        return 1;
+
+    if (gs_list_spill() && words <= gs_list_room())
+        return 1;
+
+    gs_list_stats.dropped++;
+
+    return 0;
+}
+
+/*
+ * Draw mode tracking.
+ * Packets added in sequence are drawn in the same order, so a packet
+ * can leave out its draw mode setting when the GPU will already be using it.
+ * Packets sorted in an ordering table are drawn after all of those and in
+ * a different order, so they always carry their own and are not tracked.
+ */
+
+static void gs_put_draw_mode(const unsigned int header_pos, const unsigned int md)
+{
+    if (gs_ot_depth < 0)
+    {
+        if (gs_draw_mode_tracking && gs_draw_mode_valid && gs_draw_mode == md)
+        {
+            /* One word less in the packet. */
+            linked_list[header_pos] -= 0x01000000;
+            return;
+        }
+
+        gs_draw_mode = md;
+        gs_draw_mode_valid = 1;
+    }
+
+    linked_list[linked_list_pos++] = md;
+}
+
+static void gs_track_draw_mode(const unsigned int md)
+{
+    if (gs_ot_depth < 0)
+    {
+        gs_draw_mode = md;
+        gs_draw_mode_valid = 1;
+    }
+}
+
+static void gs_track_texpage(const unsigned int md)
+{
+    /* Textured polygons replace the texture page bits of the draw mode. */
+    if (gs_ot_depth < 0)
+        gs_draw_mode = (gs_draw_mode & ~0x1ff) | (md & 0x1ff);
+}
+
+/*
+ * Links a chain of packets, from the one whose header is first
+ * to the one whose header is last, either at the end of the sequential
+ * chain or at the head of the ordering table bucket selected by gs_ot_depth.
+ * The packets in the chain must already be linked to each other.
+ * The chain can be in the primitive list, in which case it must end at
+ * linked_list_pos, or anywhere else in RAM.
+ */
+
+static void gs_link_chain(unsigned int *first, unsigned int *last)
+{
+    unsigned int next = ((uintptr_t)&linked_list[linked_list_pos]) & 0xffffff;
+    unsigned int z;
+
+    if (gs_ot == NULL || gs_ot_depth < 0)
+    {
+        if (linked_list_tail != NULL)
+            *linked_list_tail = (*linked_list_tail & 0xff000000) | (((uintptr_t)first) & 0xffffff);
+        else
+            linked_list_head = first;
+
+        *last = (*last & 0xff000000) | next;
+        linked_list_tail = last;
+        return;
+    }
+
+    z = gs_ot_depth;
+
+    if (z >= gs_ot_entries)
+        z = gs_ot_entries - 1;
+
+    /* Insert the chain at the head of the bucket. */
+    *last = (*last & 0xff000000) | (gs_ot[z] & 0xffffff);
+    gs_ot[z] = (gs_ot[z] & 0xff000000) | (((uintptr_t)first) & 0xffffff);
+
+    /* The sequential chain has to jump over the packets we just took out of it. */
+    if (linked_list_tail != NULL)
+        *linked_list_tail = (*linked_list_tail & 0xff000000) | next;
+    else
+        linked_list_head = &linked_list[linked_list_pos];
+}
+
+static void gs_link_packet(const unsigned int orig_pos)
+{
+    gs_link_chain(&linked_list[orig_pos], &linked_list[orig_pos]);
+}
+
+/*
+ * Walks a sequentially built packet list up to pos,
+ * and returns a pointer to the last packet header, or NULL.
+ */
+
+static unsigned int *gs_find_list_tail(const unsigned int pos)
+{
+    unsigned int base = ((uintptr_t)linked_list) & 0xffffff;
+    unsigned int cur = 0;
+    unsigned int next;
+    unsigned int *tail = NULL;
+
+    while (cur < pos)
+    {
+        next = ((linked_list[cur] & 0xffffff) - base) >> 2;
+
+        if (next <= cur)
+            break;
+
+        tail = &linked_list[cur];
+        cur = next;
+    }
+
+    return tail;
+}
+
+void GsOTInit(unsigned int *ot, unsigned int entries)
+{
+    int x;
+
+    /* The first entry ends the table, every other one is an empty packet linking to the previous entry. */
+    ot[0] = 0x00ffffff;
+
+    for (x = 1; x < entries; x++)
+        ot[x] = ((uintptr_t)&ot[x - 1]) & 0xffffff;
+
+    gs_ot = ot;
+    gs_ot_entries = entries;
+}
+
+/*
+ * Terminates the packet list, and returns a pointer to the first packet.
+ * If an ordering table is set, the list is terminated with an empty packet
+ * linking to its deepest entry, and the ordering table is then released.
+ */
+
+static unsigned int *gs_terminate_list(void)
+{
+    if (gs_ot != NULL && gs_ot_entries > 0)
+        linked_list[linked_list_pos] = ((uintptr_t)&gs_ot[gs_ot_entries - 1]) & 0xffffff;
+    else
+        linked_list[linked_list_pos] = 0x00ffffff;
+
+    gs_ot = NULL;
+    gs_ot_entries = 0;
+
+    return linked_list_head;
+}
+
+/*
+ * Starts a linked list DMA transfer to the GPU on channel 2.
+ */
+
+static void gs_start_list_dma(const unsigned int *list_start)
+{
+    /* Wait for a previous transfer to end before reprogramming the channel. */
+    PSX_ProfBegin(PROF_GPU_LIST);
+    while (D2_CHCR & (1<<0x18));
+    PSX_ProfEnd(PROF_GPU_LIST);
+
+    /* DMA CPU->GPU mode. */
+    gpu_ctrl(4, 2);
+
+    D2_MADR = (uintptr_t)list_start;
+    D2_BCR = 0;
+    D2_CHCR = (1<<0xa)|1|(1<<0x18);
 }
 
 void GsDrawList(void)
 {
+    unsigned int *list_start;
+
     if (PSX_GetInitFlags() & PSX_INIT_NOBIOS)
     {
         /* DMA is unreliable right now, use PIO. */
@@ -148,7 +467,9 @@ void GsDrawList(void)
     }
 
     /* Put a terminator, so the link listed ends. */
-    linked_list[linked_list_pos] = 0x00ffffff;
+    list_start = gs_terminate_list();
+
+    PSX_ProfBegin(PROF_GPU_LIST);
 
     /* Wait for the GPU to finish drawing primitives. */
     while (!(GPU_CONTROL_PORT & (1<<0x1a)));
@@ -156,110 +477,211 @@ void GsDrawList(void)
     /* Wait for the GPU to be free. */
     while (!(GPU_CONTROL_PORT & (1<<0x1c)));
 
-    /* DMA CPU->GPU mode. */
-    gpu_ctrl(4, 2);
+    PSX_ProfEnd(PROF_GPU_LIST);
 
-    D2_MADR = (unsigned int)linked_list;
-    D2_BCR = 0;
-    D2_CHCR = (1<<0xa)|1|(1<<0x18);
+    gs_start_list_dma(list_start);
 
     /* Reset primitive list iterator. */
-    linked_list_pos = 0;
+    gs_list_reset();
 
     if (__gs_autowait)
     {
         /* Wait until GPU has finished drawing. */
-        while (GsIsDrawing());
+        gs_wait_drawing();
+    }
+}
+
+int GsListInit(unsigned int *const *buffers, unsigned int count)
+{
+    int x;
+
+    if (count == 0)
+        return 0;
+
+    if (count > GS_LIST_MAX_BUFFERS)
+        count = GS_LIST_MAX_BUFFERS;
+
+    for (x = 0; x < count; x++)
+        gs_list_buffers[x] = buffers[x];
+
+    gs_list_count = count;
+    gs_list_cur = 0;
+    gs_list_inflight = -1;
+
+    GsSetList(gs_list_buffers[0]);
+
+    return 1;
+}
+
+void GsListSubmit(void)
+{
+    unsigned int *list_start;
+
+    if (PSX_GetInitFlags() & PSX_INIT_NOBIOS)
+    {
+        /* PIO is blocking, nothing is left in flight. */
+        GsDrawListPIO();
+        gs_list_inflight = -1;
+        return;
+    }
+
+    list_start = gs_terminate_list();
+
+    /*
+     * Do not wait for the GPU to be idle, the DMA controller
+     * only feeds it when it requests more data.
+     */
+    gs_start_list_dma(list_start);
+
+    gs_list_inflight = gs_list_cur;
+
+    gs_list_reset();
+
+    if (__gs_autowait)
+    {
+        while (D2_CHCR & (1<<0x18));
+        gs_wait_drawing();
+    }
+}
+
+unsigned int *GsListSwap(void)
+{
+    if (gs_list_count == 0)
+        return linked_list;
+
+    gs_list_cur = (gs_list_cur + 1) % gs_list_count;
+
+    /* Only the last submitted buffer can still be read by DMA. */
+    if (gs_list_cur == gs_list_inflight)
+    {
+        while (D2_CHCR & (1<<0x18));
+        gs_list_inflight = -1;
     }
+
+    GsSetList(gs_list_buffers[gs_list_cur]);
+
+    return gs_list_buffers[gs_list_cur];
+}
+
+int GsListIsBusy(void)
+{
+    return (gs_list_inflight >= 0) && (D2_CHCR & (1<<0x18));
 }
 
 void GsDrawListPIO(void)
 {
-    int pos = 0;
+    uintptr_t base = ((uintptr_t)linked_list) & ~(uintptr_t)0xffffff;
+    unsigned int *packet;
+
+    /* Follow the links like DMA would, packets might be in an ordering table. */
+    packet = gs_terminate_list();
 
     while (!(GPU_CONTROL_PORT & (1<<0x1c)));
 
     /* Disable DMA. */
     GPU_CONTROL_PORT = 0x04000000;
 
-    while (pos < linked_list_pos)
+    while (1)
     {
         int sz = 0;
         int x;
 
-        while (!(GPU_CONTROL_PORT & (1<<0x1c)));
+        sz = packet[0] >> 24;
 
-        GPU_DATA_PORT = 0x01000000; // Reset data port
+        if (sz > 0)
+        {
+            while (!(GPU_CONTROL_PORT & (1<<0x1c)));
 
-        sz = linked_list[pos++] >> 24;
+            GPU_DATA_PORT = 0x01000000; // Reset data port
 
-        for (x = 0; x < sz; x++)
-        {
-            GPU_DATA_PORT = linked_list[pos++];
+            for (x = 1; x <= sz; x++)
+            {
+                GPU_DATA_PORT = packet[x];
+            }
         }
+
+        if ((packet[0] & 0xffffff) == 0xffffff)
+            break;
+
+        packet = (unsigned int*)(base | (packet[0] & 0xffffff));
     }
 
     /* Reset primitive list iterator. */
-    linked_list_pos = 0;
+    gs_list_reset();
 
     if (__gs_autowait)
     {
         /* Wait until GPU has finished drawing. */
-        while (GsIsDrawing());
+        gs_wait_drawing();
     }
 }
 
 void GsSortPoly3(const GsPoly3* const poly3)
 {
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x20;
     unsigned int md;
 
+    if (!gs_list_reserve(6))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, poly3->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x05000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(poly3->b<<16)|(poly3->g<<8)|(poly3->r);
 
     for (x = 0; x < 3; x++)
         linked_list[linked_list_pos++] = ((poly3->y[x]&0x7ff)<<16)|(poly3->x[x]&0x7ff);
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortPoly4(const GsPoly4* const poly4)
 {
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x28;
     unsigned int md;
 
+    if (!gs_list_reserve(7))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, poly4->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x06000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(poly4->b<<16)|(poly4->g<<8)|(poly4->r);
 
     for (x = 0; x < 4; x++)
         linked_list[linked_list_pos++] = ((poly4->y[x]&0x7ff)<<16)|(poly4->x[x]&0x7ff);
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGPoly3(const GsGPoly3* const poly3)
 {
     // PKT 0x30
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x30;
     unsigned int md;
 
+    if (!gs_list_reserve(8))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, poly3->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x07000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
 
     for (x = 0; x < 3; x++)
     {
@@ -267,22 +689,27 @@ void GsSortGPoly3(const GsGPoly3* const poly3)
         linked_list[linked_list_pos++] = ((poly3->y[x]&0x7ff)<<16)|(poly3->x[x]&0x7ff);
     }
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGPoly4(const GsGPoly4* const poly4)
 {
     // PKT 0x38
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x38;
     unsigned int md;
 
+    if (!gs_list_reserve(10))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, poly4->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x09000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
 
     for (x = 0; x < 4; x++)
     {
@@ -290,43 +717,53 @@ void GsSortGPoly4(const GsGPoly4* const poly4)
         linked_list[linked_list_pos++] = ((poly4->y[x]&0x7ff)<<16)|(poly4->x[x]&0x7ff);
     }
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortLine(const GsLine* const line)
 {
     // PKT 0x40
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x40;
     unsigned int md;
 
+    if (!gs_list_reserve(5))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, line->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x04000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(line->b<<16)|(line->g<<8)|(line->r);
 
     for (x = 0; x < 2; x++)
         linked_list[linked_list_pos++] = ((line->y[x]&0x7ff)<<16)|(line->x[x]&0x7ff);
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGLine(const GsGLine* const line)
 {
     // PKT 0x50
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x50;
     unsigned int md;
 
+    if (!gs_list_reserve(6))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, line->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x05000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
 
     for (x=0;x<2;x++)
     {
@@ -334,23 +771,28 @@ void GsSortGLine(const GsGLine* const line)
         linked_list[linked_list_pos++] = ((line->y[x]&0x7ff)<<16)|(line->x[x] & 0x7ff);
     }
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortDot(const GsDot* const dot)
 {
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     unsigned char pkt = 0x68;
     unsigned int md;
 
+    if (!gs_list_reserve(4))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, dot->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x03000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(dot->b<<16)|(dot->g<<8)|(dot->r);
     linked_list[linked_list_pos++] = ((dot->y&0x7ff)<<16)|(dot->x&0x7ff);
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortSprite(const GsSprite* const sprite)
@@ -363,6 +805,9 @@ void GsSortSprite(const GsSprite* const sprite)
         GsTPoly4 tpoly4;
         int x;
         int mcx, mcy;
+        int w, h;
+        int c, sn;
+        int vx[4], vy[4];
 
         tpoly4.u[0] = sprite->u;
         tpoly4.v[0] = sprite->v;
@@ -376,28 +821,26 @@ void GsSortSprite(const GsSprite* const sprite)
         tpoly4.u[3] = sprite->u + sprite->w;
         tpoly4.v[3] = sprite->v + sprite->h;
 
-        gs_vbuf[0][2] = gs_vbuf[1][2] = gs_vbuf[2][2] = gs_vbuf[3][2] = 0;
-
         mcx = sprite->mx + sprite->x;
         mcy = sprite->my + sprite->y;
 
-        gs_vbuf[0][0] = -(mcx - sprite->x);
-        gs_vbuf[0][1] = (mcy - sprite->y);
+        w = gs_calculate_scaled_size(sprite->w, sprite->scalex);
+        h = gs_calculate_scaled_size(sprite->h, sprite->scaley);
 
-        gs_vbuf[1][0] = -(mcx - sprite->x);
-        gs_vbuf[1][1] = (mcy - (sprite->y + gs_calculate_scaled_size(sprite->h, sprite->scaley)));
+        /* Vertexes relative to the rotation center, with Y pointing up. */
+        vx[0] = vx[1] = -(mcx - sprite->x);
+        vx[2] = vx[3] = -(mcx - (sprite->x + w));
+        vy[0] = vy[2] = (mcy - sprite->y);
+        vy[1] = vy[3] = (mcy - (sprite->y + h));
 
-        gs_vbuf[2][0] =  -(mcx - (sprite->x + gs_calculate_scaled_size(sprite->w, sprite->scalex)));
-        gs_vbuf[2][1] = (mcy - sprite->y);
-
-        gs_vbuf[3][0] =  -(mcx - (sprite->x + gs_calculate_scaled_size(sprite->w, sprite->scalex)));
-        gs_vbuf[3][1] = (mcy - (sprite->y + gs_calculate_scaled_size(sprite->h, sprite->scaley)));
+        c = gs_internal_cos_fx(sprite->rotate);
+        sn = gs_internal_sin_fx(sprite->rotate);
 
+        /* Rotation about the Z axis, in 4.12 fixed point, rounded to the nearest pixel. */
         for (x = 0; x < 4; x++)
         {
-            gs_internal_vector_rotate(0, 0, sprite->rotate, gs_vbuf[x], gs_vbuf[x]);
-            tpoly4.x[x] = mcx + gs_vbuf[x][0];
-            tpoly4.y[x] = mcy + gs_vbuf[x][1];
+            tpoly4.x[x] = ((mcx << 12) + (c * vx[x]) + (sn * vy[x]) + 2048) >> 12;
+            tpoly4.y[x] = ((mcy << 12) + (sn * vx[x]) - (c * vy[x]) + 2048) >> 12;
         }
 
         tpoly4.r = sprite->r;
@@ -495,45 +938,60 @@ void GsSortSprite(const GsSprite* const sprite)
 
 void GsSortSimpleSprite(const GsSprite* const sprite)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
     unsigned char pkt = 0x64;
     unsigned int md;
 
+    if (!gs_list_reserve(6))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(sprite->tpage, sprite->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x05000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(sprite->b<<16)|(sprite->g<<8)|sprite->r;
     linked_list[linked_list_pos++] = ((sprite->y&0x7ff)<<16)|(sprite->x&0x7ff);
     linked_list[linked_list_pos++] = (get_clutid(sprite->cx,sprite->cy)<<16)|(sprite->v<<8)|sprite->u;
     linked_list[linked_list_pos++] = (sprite->h<<16)|sprite->w;
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortRectangle(const GsRectangle* const rectangle)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
     unsigned char pkt = 0x60;
     unsigned int md;
 
+    if (!gs_list_reserve(5))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, rectangle->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x04000000;
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(rectangle->b<<16)|(rectangle->g<<8)|(rectangle->r);
     linked_list[linked_list_pos++] = ((rectangle->y&0x7ff)<<16)|(rectangle->x&0x7ff);
     linked_list[linked_list_pos++] = (rectangle->h<<16)|rectangle->w;
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortTPoly4(const GsTPoly4* const tpoly4)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
     unsigned char pkt = 0x2c;
     unsigned int md;
 
+    if (!gs_list_reserve(10))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(tpoly4->tpage, tpoly4->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x09000000;
@@ -547,16 +1005,22 @@ void GsSortTPoly4(const GsTPoly4* const tpoly4)
     linked_list[linked_list_pos++] = ((tpoly4->y[3]&0x7ff)<<16)|(tpoly4->x[3]&0x7ff);
     linked_list[linked_list_pos++] = (tpoly4->v[3]<<8)|tpoly4->u[3];
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_track_texpage(md);
+    gs_link_packet(orig_pos);
 }
 
 void GsSortTPoly3(const GsTPoly3* const tpoly3)
 {
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x24;
     unsigned int md;
 
+    if (!gs_list_reserve(8))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(tpoly3->tpage, tpoly3->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x07000000;
@@ -584,7 +1048,8 @@ void GsSortTPoly3(const GsTPoly3* const tpoly3)
         }
     }
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_track_texpage(md);
+    gs_link_packet(orig_pos);
 }
 
 void MoveImage(int src_x, int src_y, int dst_x, int dst_y, int w, int h)
@@ -608,17 +1073,18 @@ void MoveImage(int src_x, int src_y, int dst_x, int dst_y, int w, int h)
  * Add a method to add arbitrary data to the packet list
  */
 
-void LoadImage(void *img, int x, int y, int w, int h)
+static void load_image_pio(const unsigned short *image, int x, int y, int w, int h)
 {
-    unsigned short*image = (unsigned short*)img;
     int a, l;
 
-    while (GsIsDrawing() == true);
+    PSX_ProfBegin(PROF_IMAGE);
 
-    //printf("LoadImage: %d, %d, %d, %d\n", x, y, w, h);
+    gs_wait_drawing();
 
     while (!(GPU_CONTROL_PORT & (1<<0x1c)));
 
+    PSX_ProfEnd(PROF_IMAGE);
+
     GPU_CONTROL_PORT = 0x04000000; // Disable DMA
 
 // Reset should be on data port ! otherwise we won't be able
@@ -638,32 +1104,117 @@ void LoadImage(void *img, int x, int y, int w, int h)
         GPU_DATA_PORT = image[a]|(image[a+1]<<16);
 
     GPU_CONTROL_PORT = 0x01000000;
-//  while (!(GPU_CONTROL_PORT & (1<<0x1c)));
 }
 
-/*void LoadImage(void *img, int x, int y, int w, int h)
+/*
+ * Starts a block mode DMA transfer of image data to the framebuffer.
+ * Returns the number of words which could not be sent in whole blocks;
+ * they have to be sent by port I/O once the transfer has ended.
+ */
+
+static unsigned int load_image_dma(const unsigned short *image, int x, int y, int w, int h)
 {
-    GPU_dw(x, y, w, h, img);
+    unsigned int words = ((w*h)+1)>>1;
+    unsigned int bs = 16;
+    unsigned int tail = 0;
 
-    int l;
+    /* Use the biggest block size which divides the transfer evenly. */
+    while (bs > 1 && (words % bs))
+        bs >>= 1;
 
-    printf("LoadImage: %d, %d, %d, %d\n", x, y, w, h);
+    /* Too many blocks, send the remainder by port I/O. */
+    if ((words / bs) > 0xffff)
+    {
+        bs = 16;
+        tail = words % bs;
+    }
 
-    l = w*h;
-    if (l&1)l++;
-    l/=2;
+    /* Wait for a previous transfer, and for the GPU to accept commands. */
+    PSX_ProfBegin(PROF_IMAGE);
+    while (D2_CHCR & (1<<0x18));
+    gs_wait_drawing();
+    while (!(GPU_CONTROL_PORT & (1<<0x1c)));
+    PSX_ProfEnd(PROF_IMAGE);
 
-    while (!(GPU_CONTROL_PORT & (1<<0x1c))); // Wait for the GPU to be free
+    /*
+     * Set DMA CPU->GPU mode directly; gpu_ctrl() would reset
+     * the command buffer after the header was sent.
+     */
+    GPU_CONTROL_PORT = 0x04000002;
 
-    gpu_ctrl(4, 2); // DMA CPU->GPU mode
-    D2_MADR = (unsigned int)img;
-    D2_BCR = (l << 16) | 1;
-    D2_CHCR = 0x01000201;
+    GPU_DATA_PORT = 0x01000000; // Clear texture cache, see load_image_pio()
+    GPU_DATA_PORT = 0xE6000000; // disable masking stuff !!
+    GPU_DATA_PORT = 0xA0000000;
+    GPU_DATA_PORT = (y<<16)|x;
+    GPU_DATA_PORT = (h<<16)|w;
+
+    if (words >= bs)
+    {
+        D2_MADR = (uintptr_t)image;
+        D2_BCR = ((words / bs) << 16) | bs;
+        D2_CHCR = 0x01000201;
+    }
+    else
+        tail = words;
+
+    return tail;
+}
+
+/*
+ * Waits for an image transfer to end, then sends the words
+ * which load_image_dma() left out.
+ */
 
-    // Wait for DMA to finish
+static void load_image_finish(const void *img, int w, int h, unsigned int tail)
+{
+    const unsigned int *image = (const unsigned int*)img;
+    unsigned int words = ((w*h)+1)>>1;
 
+    /* Wait for DMA to finish */
+    PSX_ProfBegin(PROF_IMAGE);
     while (D2_CHCR & (1<<0x18));
-//}*/
+    PSX_ProfEnd(PROF_IMAGE);
+
+    while (tail > 0)
+    {
+        GPU_DATA_PORT = image[words - tail];
+        tail--;
+    }
+}
+
+void LoadImage(void *img, int x, int y, int w, int h)
+{
+    if (PSX_GetInitFlags() & PSX_INIT_NOBIOS)
+    {
+        /* DMA is unreliable right now, use PIO. */
+        load_image_pio(img, x, y, w, h);
+        return;
+    }
+
+    load_image_finish(img, w, h, load_image_dma(img, x, y, w, h));
+}
+
+void LoadImageAsync(void *img, int x, int y, int w, int h)
+{
+    unsigned int tail;
+
+    if (PSX_GetInitFlags() & PSX_INIT_NOBIOS)
+    {
+        load_image_pio(img, x, y, w, h);
+        return;
+    }
+
+    tail = load_image_dma(img, x, y, w, h);
+
+    /* Sizes which can not be sent in whole blocks need the CPU at the end. */
+    if (tail > 0)
+        load_image_finish(img, w, h, tail);
+}
+
+int LoadImageDone(void)
+{
+    return !(D2_CHCR & (1<<0x18));
+}
 
 void GsSetDrawEnv(GsDrawEnv *drawenv)
 {
@@ -690,6 +1241,7 @@ void GsSetDrawEnv(GsDrawEnv *drawenv)
     //#warning "Check drawing offset better."
     gpu_data_ctrl(0xe5, (drawenv->y<<11)|drawenv->x);
     //gpu_data_ctrl(0xe5, 0);
+    gs_draw_offset = (0xe5<<24)|((drawenv->y & 0x7ff)<<11)|(drawenv->x & 0x7ff);
 
 
     mf = 0;
@@ -704,7 +1256,12 @@ void GsSetDrawEnv(GsDrawEnv *drawenv)
 
 void GsSetDrawEnv_DMA(GsDrawEnv* drawenv)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
+
+    if (!gs_list_reserve(6))
+        return;
+
+    orig_pos = linked_list_pos;
 
     linked_list[linked_list_pos++] = 0x05000000;
 
@@ -714,7 +1271,9 @@ void GsSetDrawEnv_DMA(GsDrawEnv* drawenv)
     linked_list[linked_list_pos++] = ((0xE4 << 24) | ((drawenv->x + drawenv->w - 1) & 0x3FF) | (((drawenv->y + drawenv->h - 1) & 0x3FF) << 10));
     linked_list[linked_list_pos++] = ((0xE5 << 24) | ((drawenv->x) & 0x7FF) | (((drawenv->y ) & 0x7FF) << 11));
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
+    gs_track_draw_mode(linked_list[orig_pos + 1]);
+    gs_draw_offset = linked_list[orig_pos + 5];
 
     GsCurDrawEnvW = drawenv->w;
     GsCurDrawEnvH = drawenv->h;
@@ -745,6 +1304,7 @@ void GsSetDrawEnv_Ex(GsDrawEnv *drawenv)
     //#warning "Check drawing offset better."
     gpu_data_ctrl(0xe5, (drawenv->y<<11)|drawenv->x);
     //gpu_data_ctrl(0xe5, 0);
+    gs_draw_offset = (0xe5<<24)|((drawenv->y & 0x7ff)<<11)|(drawenv->x & 0x7ff);
 
 
     mf = 0;
@@ -764,7 +1324,12 @@ void GsSetDispEnv(GsDispEnv *dispenv)
 
 void GsSetDispEnv_DMA(GsDispEnv *dispenv)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
+
+    if (!gs_list_reserve(2))
+        return;
+
+    orig_pos = linked_list_pos;
 
     //GsDrawListPIO();
 
@@ -772,7 +1337,7 @@ void GsSetDispEnv_DMA(GsDispEnv *dispenv)
 
     linked_list[linked_list_pos++] = (0x05 << 24) | (dispenv->x & 0x3FF) | ((dispenv->y & 0x3FF) << 10);
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_link_packet(orig_pos);
 }
 
 void gpu_ctrl(unsigned int command, unsigned int param)
@@ -946,11 +1511,11 @@ void GsClearMem()
     // and waits that it has finished drawing...
 
     DrawFBRect(0,0,1023,511,0,0,0);
-    while (GsIsDrawing());
+    gs_wait_drawing();
     DrawFBRect(0,511,1023,1,0,0,0);
-    while (GsIsDrawing());
+    gs_wait_drawing();
     DrawFBRect(1023,511,1,1,0,0,0);
-    while (GsIsDrawing());
+    gs_wait_drawing();
 }
 
 int GsImageFromTim(GsImage *image, const void* const timdata)
@@ -1093,6 +1658,18 @@ int GsIsDrawing()
     return !(GPU_CONTROL_PORT & (1<<0x1a)) ;
 }
 
+/*
+ * Waits for the GPU to finish drawing. Only the wait itself is timed,
+ * not what the caller does between two calls to GsIsDrawing().
+ */
+
+static void gs_wait_drawing(void)
+{
+    PSX_ProfBegin(PROF_GPU_DRAW);
+    while (GsIsDrawing());
+    PSX_ProfEnd(PROF_GPU_DRAW);
+}
+
 
 
 // Functions which use default values to use when you do not
@@ -1131,7 +1708,7 @@ void GsLoadFont(int fb_x, int fb_y, int cx, int cy)
     unsigned short pal[2] = {0x0, 0x7fff};
 
     LoadImage(psxsdk_font_data, fb_x, fb_y, 16, 128);
-    while (GsIsDrawing());
+    gs_wait_drawing();
 
     if (cx != -1 && cy != -1)
     {
@@ -1140,13 +1717,104 @@ void GsLoadFont(int fb_x, int fb_y, int cx, int cy)
         fb_font_cx = cx;
         fb_font_cy = cy;
 
-        while (GsIsDrawing());
+        gs_wait_drawing();
     }
 
     fb_font_x = fb_x;
     fb_font_y = fb_y;
 }
 
+/*
+ * Lays out a string with the built-in font, unscaled, as a chain of packets:
+ * a draw mode setting followed by one 8x8 fixed size sprite for each character.
+ * Packets are split so that none of them is longer than 255 words.
+ * If cull is non-zero, characters outside the drawing area are left out;
+ * spaces are always left out as they would be transparent.
+ * If wrap is non-zero, lines are wrapped at the right edge of the screen.
+ * Returns the number of words used, or -1 if size words are not enough.
+ * The offset of the last packet header is stored in last, and the
+ * final position, in the same format as GsPrintFont(), in end;
+ * the final position is stored even when the packets did not fit.
+ */
+
+static int gs_font_layout(unsigned int *buf, const unsigned int size, const char *string,
+                          const int x, const int y, const int cull, const int wrap,
+                          unsigned int *last, unsigned int *end)
+{
+    unsigned char pkt = 0x74;
+    unsigned int md, color, clut;
+    unsigned int base_u, base_v;
+    unsigned int node = 0, node_words = 1, used = 2;
+    int cx = x, cy = y;
+    int full = (size < 2);
+
+    md = setup_attribs((fb_font_x / 64) + ((fb_font_y / 256)*16), 0, &pkt);
+    color = (pkt<<24)|(prfont_bl<<16)|(prfont_gl<<8)|prfont_rl;
+    clut = get_clutid(fb_font_cx, fb_font_cy)<<16;
+    base_u = (fb_font_x & 0x3f)*4;
+    base_v = fb_font_y & 0xff;
+
+    if (!full)
+        buf[1] = md;
+
+    for (; *string; string++)
+    {
+        if (wrap && cx >= GsScreenW)
+        {
+            cx = cx - GsScreenW;
+            cy += 8;
+        }
+
+        if (*string > ' ' && *string <= '~' && !full &&
+            (!cull || ((cx < GsCurDrawEnvW && (cx+8)>=0) &&
+                       (cy < GsCurDrawEnvH && (cy+8)>=0))))
+        {
+            if ((node_words + 3) > 255 && (used + 4) <= size)
+            {
+                buf[node] = (node_words << 24) | (((uintptr_t)&buf[used]) & 0xffffff);
+                node = used++;
+                node_words = 0;
+            }
+
+            if ((node_words + 3) > 255 || (used + 3) > size)
+                full = 1;
+            else
+            {
+                buf[used++] = color;
+                buf[used++] = ((cy&0x7ff)<<16)|(cx&0x7ff);
+                buf[used++] = clut|((base_v + (*string & 0xf8))<<8)|(base_u + ((*string & 7) << 3));
+                node_words += 3;
+            }
+        }
+
+        if (*string >= ' ' && *string <= '~')
+            cx += 8;
+
+        if (*string == '\r')
+            cx = 0;
+
+        if (*string == '\n')
+        {
+            cx = (prfont_flags & PRFONT_UNIXLF)? 0 : x;
+            cy += 8;
+        }
+
+        if (*string == '\t')
+            cx += 8 * 8;
+    }
+
+    *end = (cy << 16) | (cx & 0xffff);
+
+    if (full)
+        return -1;
+
+    buf[node] = node_words << 24;
+
+    *last = node;
+
+    return used;
+}
+
 unsigned int GsPrintFont_Draw(int x, int y, int scalex, int scaley)
 {
     //int r;
@@ -1161,6 +1829,36 @@ unsigned int GsPrintFont_Draw(int x, int y, int scalex, int scaley)
 //  r = vsnprintf(gpu_stringbuf, 512, fmt, ap);
 
 //  va_end(ap);
+
+    if ((scalex == 0 || scalex == 1) && (scaley == 0 || scaley == 1))
+    {
+        /* Unscaled text is sent as a single chain of fixed size sprites. */
+        unsigned int last, end;
+        int used;
+
+        used = gs_font_layout(&linked_list[linked_list_pos], gs_list_room(), gpu_stringbuf,
+                              x, y, 1, prfont_flags & PRFONT_WRAP, &last, &end);
+
+        if (used < 0 && gs_list_spill())
+        {
+            used = gs_font_layout(&linked_list[linked_list_pos], gs_list_room(), gpu_stringbuf,
+                                  x, y, 1, prfont_flags & PRFONT_WRAP, &last, &end);
+        }
+
+        if (used < 0)
+            gs_list_stats.dropped++;
+        else if (used > 2)
+        {
+            unsigned int first_pos = linked_list_pos;
+
+            linked_list_pos += used;
+            gs_link_chain(&linked_list[first_pos], &linked_list[first_pos + last]);
+            gs_track_draw_mode(linked_list[first_pos + 1]);
+        }
+
+        return end;
+    }
+
     fw = gs_calculate_scaled_size(8, scalex);//(8*scalex)/4096;
     fh = gs_calculate_scaled_size(8, scaley);//(8*scaley)/4096;
 
@@ -1263,6 +1961,90 @@ unsigned int GsPrintFont(int x, int y, const char*fmt, ...)
     return r;
 }
 
+int GsTextInit(GsText *text, unsigned int *buffer, unsigned int size)
+{
+    text->packets = buffer;
+    text->size = size;
+    text->used = 0;
+    text->last = 0;
+    text->x = 0;
+    text->y = 0;
+
+    return 1;
+}
+
+int GsTextPrint(GsText *text, const char *fmt, ...)
+{
+    va_list ap;
+    unsigned int end;
+    int r, x = 0;
+    int used;
+
+    va_start(ap, fmt);
+    r = vsnprintf(gpu_stringbuf, 512, fmt, ap);
+    va_end(ap);
+
+    if (prfont_flags & PRFONT_CENTER)
+        x = -((r * 8) / 2);
+    else if (prfont_flags & PRFONT_RIGHT)
+        x = -(r * 8);
+
+    /* The text is laid out at 0,0 and moved when drawn, so it can't wrap at the screen edge. */
+    used = gs_font_layout(text->packets, text->size, gpu_stringbuf, x, 0, 0, 0,
+                          &text->last, &end);
+
+    if (used < 0)
+    {
+        text->used = 0;
+        return 0;
+    }
+
+    text->used = used;
+    text->x = 0;
+    text->y = 0;
+
+    return 1;
+}
+
+void GsSortText(GsText *text, int x, int y)
+{
+    unsigned int *node = text->packets;
+    unsigned int *last = &text->packets[text->last];
+    int dx = x - text->x;
+    int dy = y - text->y;
+    int first = 1;
+
+    if (text->used <= 2)
+        return;
+
+    if (dx != 0 || dy != 0)
+    {
+        /* Move every character, skipping packet headers and the draw mode setting. */
+        while (1)
+        {
+            unsigned int *p = node + 1 + first;
+            unsigned int *node_end = node + 1 + (*node >> 24);
+
+            for (; p < node_end; p += 3)
+            {
+                p[1] = ((((p[1] >> 16) + dy) & 0x7ff) << 16) | (((p[1] & 0x7ff) + dx) & 0x7ff);
+            }
+
+            if (node == last)
+                break;
+
+            node = node_end;
+            first = 0;
+        }
+
+        text->x = x;
+        text->y = y;
+    }
+
+    gs_link_chain(text->packets, last);
+    gs_track_draw_mode(text->packets[1]);
+}
+
 void GsSetFont(int fb_x, int fb_y, int cx, int cy)
 {
     if (fb_x != -1)
@@ -1359,6 +2141,45 @@ static void gs_internal_vector_rotate(int x_a, int y_a, int z_a, double *v, doub
         n[x]=b[x];
 }
 
+/*
+ * Fixed point (4.12) versions of the functions above.
+ * Unlike them, negative angles are wrapped around correctly.
+ */
+
+static int gs_internal_cos_fx(int a)
+{
+    int a_a = (a>>12) % 360;
+
+    if (a_a < 0)
+        a_a += 360;
+
+    if (a_a<=90)
+        return gs_rot_cos_tbl_fx[a_a];
+    else if (a_a<=180)
+        return -gs_rot_cos_tbl_fx[180 - a_a];
+    else if (a_a<=270)
+        return -gs_rot_cos_tbl_fx[a_a - 180];
+
+    return gs_rot_cos_tbl_fx[360 - a_a];
+}
+
+static int gs_internal_sin_fx(int a)
+{
+    int a_a = (a>>12) % 360;
+
+    if (a_a < 0)
+        a_a += 360;
+
+    if (a_a<=90)
+        return gs_rot_cos_tbl_fx[90-a_a];
+    else if (a_a<=180)
+        return gs_rot_cos_tbl_fx[a_a-90];
+    else if (a_a<=270)
+        return -gs_rot_cos_tbl_fx[270-a_a];
+
+    return -gs_rot_cos_tbl_fx[a_a-270];
+}
+
 int GsIsWorking()
 {
     return GsIsDrawing();
@@ -1390,33 +2211,164 @@ void GsRotateVector(int x_a, int y_a, int z_a, double *v, double *n)
     gs_internal_vector_rotate(x_a, y_a, z_a, v, n);
 }
 
-/*void GsSortSimpleMap(GsMap *map)
+void GsRotateVectorFx(int x_a, int y_a, int z_a, const int *v, int *n)
 {
-    unsigned int orig_pos = linked_list_pos;
-    //unsigned int
-    unsigned char pkt = 0x64;
+    int axis_m[3][3];
+    int b[3];
+    int k[3], s[3];
+    int x;
+
+    k[0] = gs_internal_cos_fx(x_a);
+    k[1] = gs_internal_cos_fx(y_a);
+    k[2] = gs_internal_cos_fx(z_a);
+
+    s[0] = gs_internal_sin_fx(x_a);
+    s[1] = gs_internal_sin_fx(y_a);
+    s[2] = gs_internal_sin_fx(z_a);
+
+    axis_m[0][0] = (k[1] * k[2]) >> 12;
+    axis_m[0][1] = ((k[0] * s[2]) >> 12) + ((((s[0]*s[1]) >> 12) * k[2]) >> 12);
+    axis_m[0][2] = ((s[0] * s[2]) >> 12) - ((((k[0]*s[1]) >> 12) * k[2]) >> 12);
+    axis_m[1][0] = -((k[1] * s[2]) >> 12);
+    axis_m[1][1] = ((k[0] * k[2]) >> 12) - ((((s[0]*s[1]) >> 12) * s[2]) >> 12);
+    axis_m[1][2] = ((s[0] * k[2]) >> 12) + ((((k[0]*s[1]) >> 12) * s[2]) >> 12);
+    axis_m[2][0] = s[1];
+    axis_m[2][1] = -((s[0] * k[1]) >> 12);
+    axis_m[2][2] = (k[0] * k[1]) >> 12;
+
+    for (x=0;x<3;x++)
+        b[x] = ((axis_m[x][0] * v[0]) + (axis_m[x][1] * v[1]) + (axis_m[x][2] * v[2])) >> 12;
+
+    b[1]=-b[1];
+
+    for (x=0;x<3;x++)
+        n[x]=b[x];
+}
+
+/*
+ * Ordering table variants of the GsSort*() functions. They reuse the
+ * packet building code, the depth is only consulted by gs_link_packet().
+ */
+
+#define GS_DEFINE_SORT_Z(name, type) \
+    void name##Z(const type* const prim, const unsigned int z) \
+    { \
+        gs_ot_depth = z; \
+        name(prim); \
+        gs_ot_depth = -1; \
+    }
+
+GS_DEFINE_SORT_Z(GsSortPoly3, GsPoly3)
+GS_DEFINE_SORT_Z(GsSortPoly4, GsPoly4)
+GS_DEFINE_SORT_Z(GsSortGPoly3, GsGPoly3)
+GS_DEFINE_SORT_Z(GsSortGPoly4, GsGPoly4)
+GS_DEFINE_SORT_Z(GsSortTPoly3, GsTPoly3)
+GS_DEFINE_SORT_Z(GsSortTPoly4, GsTPoly4)
+GS_DEFINE_SORT_Z(GsSortGTPoly3, GsGTPoly3)
+GS_DEFINE_SORT_Z(GsSortGTPoly4, GsGTPoly4)
+GS_DEFINE_SORT_Z(GsSortLine, GsLine)
+GS_DEFINE_SORT_Z(GsSortGLine, GsGLine)
+GS_DEFINE_SORT_Z(GsSortDot, GsDot)
+GS_DEFINE_SORT_Z(GsSortSprite, GsSprite)
+GS_DEFINE_SORT_Z(GsSortSimpleSprite, GsSprite)
+GS_DEFINE_SORT_Z(GsSortRectangle, GsRectangle)
+GS_DEFINE_SORT_Z(GsSortPolyLine, GsPolyLine)
+GS_DEFINE_SORT_Z(GsSortGPolyLine, GsGPolyLine)
+GS_DEFINE_SORT_Z(GsSortSimpleMap, GsMap)
+GS_DEFINE_SORT_Z(GsSortBlock, GsBlock)
+
+void GsSortSimpleMap(const GsMap* const map)
+{
+    unsigned int first_pos;
+    unsigned int node_pos;
+    unsigned int node_words;
+    unsigned int tile_words;
+    unsigned int color, clut, size = 0;
+    unsigned int tpr, tpr_shift = 0;
+    unsigned int tn, tu, tv;
+    unsigned char pkt;
     unsigned int md;
-    unsigned char curCount = 0;
-    unsigned int remaining;
-    unsigned int tn;
-    unsigned short tu;
-    unsigned short tv;
+    int x0, x1, y0, y1;
     int x, y;
 
+    if (map->tw == 0 || map->th == 0 || map->tmw < map->tw)
+        return;
+
+    /* Visible tiles only. */
+    x0 = (map->x < 0) ? (-map->x / map->tw) : 0;
+    y0 = (map->y < 0) ? (-map->y / map->th) : 0;
+    x1 = ((GsCurDrawEnvW - map->x) + map->tw - 1) / map->tw;
+    y1 = ((GsCurDrawEnvH - map->y) + map->th - 1) / map->th;
+
+    if (x1 > map->w)
+        x1 = map->w;
+
+    if (y1 > map->h)
+        y1 = map->h;
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    /*
+     * 8x8 and 16x16 tiles use the fixed size sprite primitives,
+     * which need one word less than the free size one.
+     */
+
+    if (map->tw == 8 && map->th == 8)
+    {
+        pkt = 0x74;
+        tile_words = 3;
+    }
+    else if (map->tw == 16 && map->th == 16)
+    {
+        pkt = 0x7c;
+        tile_words = 3;
+    }
+    else
+    {
+        pkt = 0x64;
+        tile_words = 4;
+        size = (map->th<<16)|map->tw;
+    }
+
+    /* Worst case: every visible tile, plus packet headers and the draw mode packet. */
+    tn = (x1 - x0) * (y1 - y0) * tile_words;
+
+    if (!gs_list_reserve(tn + (tn / 240) + 3))
+        return;
+
+    first_pos = linked_list_pos;
+
     md = setup_attribs(map->tpage, map->attribute, &pkt);
 
-    linked_list[linked_list_pos++] = 0x01000000;
-    linked_list[linked_list_pos++] = md;
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    color = (pkt<<24)|(map->b<<16)|(map->g<<8)|map->r;
+    clut = get_clutid(map->cx, map->cy)<<16;
 
-    orig_pos = linked_list_pos;
-    linked_list[linked_list_pos++] = 0x00000000;
+    /* Tiles per tileset row, avoid dividing when it is a power of two. */
+    tpr = map->tmw / map->tw;
+
+    if (!(tpr & (tpr - 1)))
+    {
+        while ((1 << tpr_shift) < tpr)
+            tpr_shift++;
+    }
+    else
+        tpr_shift = 0xff;
 
-    remaining = map->w * map->h;
+    /*
+     * A single draw mode packet for the whole map. The node header counts it
+     * before gs_put_draw_mode(), which takes it off again if it is left out.
+     */
+    node_pos = linked_list_pos++;
+    linked_list[node_pos] = 1 << 24;
+    gs_put_draw_mode(node_pos, md);
+    node_words = linked_list[node_pos] >> 24;
 
-    for (y = 0; y < map->h; y++)
+    for (y = y0; y < y1; y++)
     {
-        for (x = 0; x < map->w; x++)
+        int sy = (map->y + (y * map->th)) & 0x7ff;
+
+        for (x = x0; x < x1; x++)
         {
             switch(map->tsize)
             {
@@ -1426,62 +2378,222 @@ void GsRotateVector(int x_a, int y_a, int z_a, double *v, double *n)
                 case 2:
                     tn = ((unsigned short*)map->data)[(y * map->l) + x];
                 break;
-                case 4:
+                default:
                     tn = ((unsigned int*)map->data)[(y * map->l) + x];
                 break;
             }
 
             tn &= ~map->tmask;
 
-            tu = (tn * map->tw) % map->tmw;
-            tv = ((tn * map->tw) / map->tmw) * map->th;
-
-            linked_list[linked_list_pos++] = (pkt<<24)|(map->b<<16)|(map->g<<8)|map->r;
-            linked_list[linked_list_pos++] = (((map->y+(y*map->th))&0x7ff)<<16)|((map->x+(x*map->tw))&0x7ff);
-            linked_list[linked_list_pos++] = (get_clutid(map->cx,map->cy)<<16)|((tv+map->v)<<8)|
-                (tu+map->u);
-            linked_list[linked_list_pos++] = (map->th<<16)|map->tw;
-
-            curCount++;
+            if (tpr_shift != 0xff)
+            {
+                tu = (tn & (tpr - 1)) * map->tw;
+                tv = (tn >> tpr_shift) * map->th;
+            }
+            else
+            {
+                tu = (tn % tpr) * map->tw;
+                tv = (tn / tpr) * map->th;
+            }
 
-            if (curCount == 252)
+            /* A packet can not be longer than 255 words, start a new one. */
+            if ((node_words + tile_words) > 255)
             {
-                linked_list[orig_pos] = (252 << 24) | (((unsigned int)&linked_list[linked_list_pos]) & 0xffffff);
-                orig_pos = linked_list_pos;
+                linked_list[node_pos] = (node_words << 24) |
+                    (((uintptr_t)&linked_list[linked_list_pos]) & 0xffffff);
+                node_pos = linked_list_pos++;
+                node_words = 0;
+            }
 
-                remaining -= curCount;
+            linked_list[linked_list_pos++] = color;
+            linked_list[linked_list_pos++] = (sy<<16)|((map->x + (x * map->tw)) & 0x7ff);
+            linked_list[linked_list_pos++] = clut|((tv + map->v)<<8)|(tu + map->u);
 
-                if (remaining > 0)
-                    linked_list_pos++;
+            if (tile_words == 4)
+                linked_list[linked_list_pos++] = size;
 
-                curCount = 0;
-            }
+            node_words += tile_words;
         }
     }
 
-    if (curCount > 0)
-        linked_list[orig_pos] = (curCount << 24) | (((unsigned int)&linked_list[linked_list_pos]) & 0xffffff);
-}*/
+    linked_list[node_pos] = node_words << 24;
+    gs_link_chain(&linked_list[first_pos], &linked_list[node_pos]);
+}
 
 void GsSetListEx(unsigned int *listptr, unsigned int listpos)
 {
+    gs_list_primary = listptr;
+    gs_list_size = gs_list_primary_size;
+    gs_list_spilled = 0;
     linked_list = listptr;
     linked_list_pos = listpos;
+    linked_list_head = linked_list;
+    linked_list_tail = gs_find_list_tail(listpos);
+    gs_draw_mode_valid = 0;
+}
+
+void GsSetListCapacity(unsigned int words)
+{
+    gs_list_primary_size = words;
+
+    if (linked_list == gs_list_primary)
+        gs_list_size = words;
+}
+
+void GsSetListOverflow(unsigned int *buffer, unsigned int words)
+{
+    gs_list_overflow = buffer;
+    gs_list_overflow_size = words;
+}
+
+void GsListGetStats(GsListStats *stats)
+{
+    *stats = gs_list_stats;
+    stats->used = gs_list_spilled + linked_list_pos;
+
+    if (stats->used > stats->high_water)
+        stats->high_water = stats->used;
+}
+
+void GsListResetStats(void)
+{
+    gs_list_stats.used = 0;
+    gs_list_stats.high_water = 0;
+    gs_list_stats.overflows = 0;
+    gs_list_stats.dropped = 0;
+}
+
+void GsSetDrawModeTracking(int enabled)
+{
+    gs_draw_mode_tracking = enabled;
+}
+
+void GsBlockBegin(GsBlock *block, unsigned int *buffer, unsigned int words)
+{
+    if (gs_block != NULL)
+        return;
+
+    gs_block_saved.list = linked_list;
+    gs_block_saved.pos = linked_list_pos;
+    gs_block_saved.head = linked_list_head;
+    gs_block_saved.tail = linked_list_tail;
+    gs_block_saved.size = gs_list_size;
+    gs_block_saved.spilled = gs_list_spilled;
+    gs_block_saved.overflow = gs_list_overflow;
+    gs_block_saved.ot = gs_ot;
+    gs_block_saved.ot_entries = gs_ot_entries;
+    gs_block_saved.draw_mode = gs_draw_mode;
+    gs_block_saved.draw_mode_valid = gs_draw_mode_valid;
+    gs_block_saved.dropped = gs_list_stats.dropped;
+
+    /*
+     * Packets go to the block buffer, in sequence: without an ordering table
+     * gs_link_chain() appends everything to the sequential chain.
+     */
+    linked_list = buffer;
+    linked_list_pos = 0;
+    linked_list_head = buffer;
+    linked_list_tail = NULL;
+    gs_list_size = words;
+    gs_list_spilled = 0;
+    gs_list_overflow = NULL;
+    gs_ot = NULL;
+    gs_ot_entries = 0;
+    gs_draw_mode_valid = 0;
+
+    gs_block = block;
+}
+
+int GsBlockEnd(void)
+{
+    int ret;
+
+    if (gs_block == NULL)
+        return -1;
+
+    gs_block->first = (linked_list_tail != NULL) ? linked_list_head : NULL;
+    gs_block->last = linked_list_tail;
+    gs_block->size = linked_list_pos;
+
+    ret = (gs_list_stats.dropped != gs_block_saved.dropped) ? -1 : 0;
+
+    linked_list = gs_block_saved.list;
+    linked_list_pos = gs_block_saved.pos;
+    linked_list_head = gs_block_saved.head;
+    linked_list_tail = gs_block_saved.tail;
+    gs_list_size = gs_block_saved.size;
+    gs_list_spilled = gs_block_saved.spilled;
+    gs_list_overflow = gs_block_saved.overflow;
+    gs_ot = gs_block_saved.ot;
+    gs_ot_entries = gs_block_saved.ot_entries;
+    gs_draw_mode = gs_block_saved.draw_mode;
+    gs_draw_mode_valid = gs_block_saved.draw_mode_valid;
+
+    gs_block = NULL;
+
+    return ret;
+}
+
+void GsSortBlock(const GsBlock *block)
+{
+    if (block->first == NULL)
+        return;
+
+    /* The last packet of the block is relinked every time. */
+    gs_link_chain(block->first, block->last);
+
+    /* The draw mode left by the block is not known. */
+    if (gs_ot_depth < 0)
+        gs_draw_mode_valid = 0;
+}
+
+void GsSortBlockOffset(const GsBlock *block, int x, int y)
+{
+    unsigned int orig_pos;
+    unsigned int ox, oy;
+
+    if (block->first == NULL || !gs_list_reserve(4))
+        return;
+
+    orig_pos = linked_list_pos;
+
+    /* The offset is relative to the one of the current drawing environment. */
+    ox = ((gs_draw_offset & 0x7ff) + x) & 0x7ff;
+    oy = (((gs_draw_offset >> 11) & 0x7ff) + y) & 0x7ff;
+
+    /* Offset packet, linked to the block, which links to the restore packet. */
+    linked_list[linked_list_pos++] = 0x01000000 | (((uintptr_t)block->first) & 0xffffff);
+    linked_list[linked_list_pos++] = (0xe5<<24)|(oy<<11)|ox;
+
+    *block->last = (*block->last & 0xff000000) | (((uintptr_t)&linked_list[linked_list_pos]) & 0xffffff);
+
+    linked_list[linked_list_pos++] = 0x01000000;
+    linked_list[linked_list_pos++] = gs_draw_offset;
+
+    gs_link_chain(&linked_list[orig_pos], &linked_list[orig_pos + 2]);
+
+    if (gs_ot_depth < 0)
+        gs_draw_mode_valid = 0;
 }
 
 void GsSortPolyLine(const GsPolyLine* const line)
 {
     // PKT 0x48
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x48;
     unsigned int md;
 
+    if (!gs_list_reserve(line->npoints + 4))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, line->attribute, &pkt);
 
     linked_list_pos++; // skip this word, we will replace it later
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
     linked_list[linked_list_pos++] = (pkt<<24)|(line->b<<16)|(line->g<<8)|(line->r);
 
     for (x = 0; x < line->npoints; x++)
@@ -1489,22 +2601,28 @@ void GsSortPolyLine(const GsPolyLine* const line)
 
     linked_list[linked_list_pos++] = 0x55555555; // termination code
 
-    linked_list[orig_pos] = ((line->npoints+3) << 24) | (((unsigned int)&linked_list[linked_list_pos]) & 0xffffff);
+    linked_list[orig_pos] = (linked_list_pos - orig_pos - 1) << 24;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGPolyLine(const GsGPolyLine* const line)
 {
     // PKT 0x58
 
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x58;
     unsigned int md;
 
+    if (!gs_list_reserve((line->npoints * 2) + 3))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(0, line->attribute, &pkt);
 
     linked_list_pos++; // skip this word, we will replace it later
-    linked_list[linked_list_pos++] = md;
+    gs_put_draw_mode(orig_pos, md);
 
     for (x=0; x < line->npoints;x++)
     {
@@ -1514,15 +2632,21 @@ void GsSortGPolyLine(const GsGPolyLine* const line)
 
     linked_list[linked_list_pos++] = 0x55555555; // termination code
 
-    linked_list[orig_pos] = (((line->npoints*2)+2) << 24) | (((unsigned int)&linked_list[linked_list_pos]) & 0xffffff);
+    linked_list[orig_pos] = (linked_list_pos - orig_pos - 1) << 24;
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGTPoly4(const GsGTPoly4* const tpoly4)
 {
-    unsigned int orig_pos = linked_list_pos;
+    unsigned int orig_pos;
     unsigned char pkt = 0x3c;
     unsigned int md;
 
+    if (!gs_list_reserve(13))
+        return;
+
+    orig_pos = linked_list_pos;
+
     /*md = setup_attribs(tpoly4->tpage, tpoly4->attribute, &pkt);*/
 
     //printf("tpoly4->tpage = %d\n", tpoly4->tpage);
@@ -1550,16 +2674,22 @@ void GsSortGTPoly4(const GsGTPoly4* const tpoly4)
     linked_list[linked_list_pos++] = ((tpoly4->y[3]&0x7ff)<<16)|(tpoly4->x[3]&0x7ff);
     linked_list[linked_list_pos++] = (tpoly4->v[3]<<8)|tpoly4->u[3];
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_track_texpage(md);
+    gs_link_packet(orig_pos);
 }
 
 void GsSortGTPoly3(const GsGTPoly3* const tpoly3)
 {
-    int orig_pos = linked_list_pos;
+    int orig_pos;
     int x;
     unsigned char pkt = 0x34;
     unsigned int md;
 
+    if (!gs_list_reserve(10))
+        return;
+
+    orig_pos = linked_list_pos;
+
     md = setup_attribs(tpoly3->tpage, tpoly3->attribute, &pkt);
 
     linked_list[linked_list_pos++] = 0x09000000;
@@ -1586,5 +2716,6 @@ void GsSortGTPoly3(const GsGTPoly3* const tpoly3)
         }
     }
 
-    linked_list[orig_pos] |= ((unsigned int)&linked_list[linked_list_pos]) & 0xffffff;
+    gs_track_texpage(md);
+    gs_link_packet(orig_pos);
 }
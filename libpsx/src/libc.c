@@ -19,6 +19,9 @@
 #include <fcntl.h>
 #include <errno.h>
 
+// Sectors read at once by fread() from CD-ROM files, and kept for the next calls
+#define FREAD_CACHE_SECTORS     4
+
 char onesec_buf[2048];
 int errno;
 int __stdio_direction = STDIO_DIRECTION_BIOS;
@@ -28,7 +31,7 @@ FILE file_structs[256];
 
 unsigned char file_state[256];
 
-int libc_get_transtbl_fname(char *tofind, char *outstr, int outl);
+const char *libc_cdindex_find(const char *name, int **size);
 
 enum
 {
@@ -111,6 +114,11 @@ FILE *fdopen(int fildes, const char *mode)
     file_structs[x].fildes = fildes;
     file_structs[x].pos = lseek(fildes, 0, SEEK_CUR);
     file_structs[x].mode = fmode_to_desmode(mode);
+    file_structs[x].cache = NULL;
+    file_structs[x].cache_pos = 0;
+    file_structs[x].cache_len = 0;
+    file_structs[x].cache_hits = 0;
+    file_structs[x].cache_reads = 0;
 
     return &file_structs[x];
 }
@@ -119,17 +127,22 @@ FILE *fopen(char *path, const char *mode)
 {
     int fd;
     FILE *f;
-    char *s = NULL;
+    const char *s = NULL;
+    int *cached_size = NULL;
+
+    // Commands queued with CdCommandAsync() keep the CD-ROM interrupts from the BIOS
+    if(strncmp(path, "cdrom", 5) == 0)
+        CdCommandWaitAll();
 
     if(strncmp(path, "cdromL:", 7) == 0)
     {
-        //printf("strncmp=%d\n", strncmp(path, "cdromL:", 7) );
-        s = malloc(1024);
+        // Long file names are looked up in the index of cdindex.c
+        s = libc_cdindex_find(path+7, &cached_size);
 
-        if(libc_get_transtbl_fname(path+7, s, 1024) == 0)
+        if(s == NULL)
             return NULL;
 
-        fd = open(s, fmode_to_desmode(mode));
+        fd = open((char*)s, fmode_to_desmode(mode));
     }
     else
     {
@@ -137,16 +150,13 @@ FILE *fopen(char *path, const char *mode)
     }
 
     if(fd == -1)
-    {
-        if(s!=NULL)free(s);
         return NULL;
-    }
 
     f = fdopen(fd, mode);
 
     if(f == NULL)
     {
-        if(s!=NULL)free(s);
+        close(fd);
         return NULL;
     }
 
@@ -159,8 +169,10 @@ FILE *fopen(char *path, const char *mode)
 
     if(s!=NULL)
     {
-        f->size = get_real_file_size(s);
-        free(s);
+        if(*cached_size < 0)
+            *cached_size = get_real_file_size((char*)s);
+
+        f->size = *cached_size;
     }
     else
         f->size = get_real_file_size(path);
@@ -170,79 +182,122 @@ FILE *fopen(char *path, const char *mode)
 
 int fclose(FILE *stream)
 {
+    if(stream->cache != NULL && stream->cache != (unsigned char*)onesec_buf)
+        free(stream->cache);
+
+    stream->cache = NULL;
     stream->used = 0;
     close(stream->fildes);
     return 0;
 }
 
+/*
+ * Reads the sectors starting with the one which holds pos into the read-ahead
+ * buffer of a CD-ROM file. If the buffer can't be allocated, onesec_buf is used
+ * instead, one sector at a time.
+ * Returns the number of bytes read, -1 on error.
+ */
+
+static int fread_fill_cache(FILE *f, unsigned int pos)
+{
+    unsigned int sector = pos & (~0x7ff);
+    int nsect = FREAD_CACHE_SECTORS;
+    int r;
+
+    if(f->cache == NULL)
+    {
+        f->cache = malloc(FREAD_CACHE_SECTORS * 2048);
+
+        if(f->cache == NULL)
+            f->cache = (unsigned char*)onesec_buf;
+    }
+
+    if(f->cache == (unsigned char*)onesec_buf)
+        nsect = 1;
+
+    // Don't read ahead past the end of the file
+    if(sector < f->size && ((f->size - sector + 2047) >> 11) < nsect)
+        nsect = (f->size - sector + 2047) >> 11;
+
+    lseek(f->fildes, sector, SEEK_SET);
+    r = read(f->fildes, f->cache, nsect * 2048);
+
+    f->cache_reads++;
+    f->cache_pos = sector;
+    f->cache_len = (r > 0) ? r : 0;
+
+    return r;
+}
+
 /*
  * fread doesn't require reads to be carried in block unit
  * Notice that however seeks on the CD drive will be very slow - so avoid using non block units
  *
  * This is done to make programming and porting easier
+ *
+ * Reads from CD-ROM files go through a read-ahead buffer of FREAD_CACHE_SECTORS
+ * sectors, so that small sequential reads (fgetc(), parsing) only read the CD
+ * once every few calls. Reads of whole sectors bigger than the buffer go directly
+ * to the destination.
  */
 
 int fread(void *ptr, int size, int nmemb, FILE *f)
 {
     int rsize = size * nmemb;
-    int csize = rsize;
-    int max;
-    int nsect = (f->pos + rsize) >> 11;
-    nsect -= f->pos >> 11;
-    nsect++;
+    unsigned int pos = f->pos;
+    unsigned int reads = f->cache_reads;
+    int left = rsize;
+    int n;
 
     //printf("f->dev = %d, f->pos = %d, rsize = %d\n", f->dev, f->pos, rsize);
 
     if(f->dev == FDEV_CDROM)
     {
-        // First sector
-        lseek(f->fildes, f->pos & (~0x7ff), SEEK_SET);
-        read(f->fildes, onesec_buf, 2048);
-
-        max = 2048 - (f->pos & 2047);
-
-        //printf("ptr(FIRST) = %d, %x\n", ptr, ptr);
-        //~dprintf("rsize = %d\n", rsize);
+        CdCommandWaitAll();
 
-        memcpy(ptr, onesec_buf + (f->pos & 2047), (rsize > max) ? max : rsize);
-
-        // Middle sector
-        ptr += max;
-
-        //printf("ptr(MIDDLEsex) = %d, %x\n", ptr, ptr);
-        nsect--;
-        csize -= max;
-
-        if(nsect > 1)
+        while(left > 0)
         {
-            //lseek(f->fildes, (f->pos & (~0x7ff)) + 2048, SEEK_SET);
+            if(pos >= f->cache_pos && pos < (f->cache_pos + f->cache_len))
+            {
+                n = f->cache_pos + f->cache_len - pos;
 
-//#warning "Check correctness of this calculation."
+                if(n > left)
+                    n = left;
 
-            /*if(rsize & 2047)
-                sect_num = (rsize|2047)+1;
-            else
-                sect_num = rsize;
+                memcpy(ptr, f->cache + (pos - f->cache_pos), n);
+            }
+            else if(!(pos & 2047) && left >= (FREAD_CACHE_SECTORS * 2048))
+            {
+                n = left & (~0x7ff);
 
-            sect_num -= 4096;*/
+                lseek(f->fildes, pos, SEEK_SET);
+                f->cache_reads++;
 
-            //printf("read_middle=%d, sect_num = %d\n", read(f->fildes, ptr, sect_num), sect_num);
+                if(read(f->fildes, ptr, n) <= 0)
+                    break;
+            }
+            else
+            {
+                // Stop at the end of the file or on errors
+                if(fread_fill_cache(f, pos) <= (int)(pos & 2047))
+                    break;
 
-            read(f->fildes, ptr, (nsect - 1) * 2048);
+                continue;
+            }
 
-            ptr += (nsect - 1) * 2048;
-            csize -= (nsect - 1) * 2048;
-            nsect = 1;
+            ptr += n;
+            pos += n;
+            left -= n;
         }
 
-        //printf("ptr(LAST) = %d, %x\n", ptr, ptr);
+        if(f->cache_reads == reads)
+            f->cache_hits++;
 
-        if(nsect == 1)
+        // onesec_buf is shared by all files, so its contents can't be kept
+        if(f->cache == (unsigned char*)onesec_buf)
         {
-            // Last sector
-            read(f->fildes, onesec_buf, 2048);
-
-            memcpy(ptr, onesec_buf, csize);
+            f->cache = NULL;
+            f->cache_len = 0;
         }
     }
 
@@ -304,166 +359,6 @@ int tolower(int c)
     return c;
 }
 
-int libc_get_transtbl_fname(char *tofind, char *outstr, int outl)
-{
-    FILE *f;
-    int s;
-    int x;
-    int type = 0;
-    int y;
-    int l = strlen(tofind);
-    int filename_found = 0;
-    int exit_loop = 0;
-    int otfp = 0;
-    int tfp = 0;
-    char transtbl[0x4000];
-    char orgname[16];
-    char newname[256];
-    char rootpath[256];
-
-    bzero(transtbl, 0x4000);
-    strcpy(rootpath, "cdrom:\\");
-
-    f = fopen("cdrom:\\TRANS.TBL;1", "rb");
-
-    if(f == NULL)
-        return 0;
-
-    fseek(f, 0, SEEK_END);
-    s = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    fread(transtbl, 1, s, f);
-    fclose(f);
-
-    outstr[0] = 0;
-
-    x = 0;
-
-    exit_loop = 0;
-    filename_found = 0;
-
-    for(tfp = 0; tofind[tfp] == '\\' || tofind[tfp] == '/'; tfp++);
-
-    otfp = tfp;
-
-    for(y = otfp; y < l; y++)
-    {
-        if(tofind[y] == '\0' || tofind[y] == '\\' || tofind[y] == '/')
-            break;
-    }
-
-    tfp = y;
-
-    while((x < s) && !exit_loop)
-    {
-        while(transtbl[x] == ' ' || transtbl[x] == '\t' || transtbl[x] == '\n' || transtbl[x] == '\r')
-            x++;
-
-        if(transtbl[x] == 'F')
-            type = 0;
-        else if(transtbl[x] == 'D')
-            type = 1;
-
-        x++;
-
-        while(transtbl[x] == ' ' || transtbl[x] == '\t' || transtbl[x] == '\n' || transtbl[x] == '\r')
-            x++;
-
-        y = 0;
-
-        while(!(transtbl[x] == ' ' || transtbl[x] == '\t' || transtbl[x] == '\n' || transtbl[x] == '\r'
-        || transtbl[x] == 0))
-                orgname[y++] = transtbl[x++];
-
-        orgname[y] = 0;
-        //printf("orgname = %s\n", orgname);
-
-        while(transtbl[x] == ' ' || transtbl[x] == '\t' || transtbl[x] == '\n' || transtbl[x] == '\r')
-            x++;
-
-        y = 0;
-
-        while(!(transtbl[x] == '\n' || transtbl[x] == '\r' || transtbl[x] == 0))
-            newname[y++] = transtbl[x++];
-
-        newname[y] = 0;
-
-        while(transtbl[x] == ' ' || transtbl[x] == '\t' || transtbl[x] == '\n' || transtbl[x] == '\r')
-            x++;
-
-        //printf("newname = %s\n", newname);
-
-        if(strncasecmp(&tofind[otfp],  newname, tfp-otfp) == 0)
-        {
-            if(type == 0)
-            {
-                dprintf("Filename found: %s -> %s%s\n", tofind, rootpath, orgname);
-                filename_found = 1;
-                exit_loop = 1;
-
-                strncpy(outstr, rootpath, outl);
-                strncat(outstr, orgname, outl-strlen(rootpath));
-            }
-            else
-            {
-                //printf("Found directory! %s\n", newname);
-
-                //printf("tfp = %d\n", tfp);
-
-                if(tfp == l || tofind[l-1] == '/'
-                    || tofind[l-1] == '\\')
-                {
-                    dprintf("File not found. A directory was specified.\n");
-                    exit_loop = 1;
-                    continue;
-                }
-
-                //tfp++;
-                for(; tofind[tfp] == '\\' || tofind[tfp] == '/'; tfp++);
-
-                otfp = tfp;
-
-                for(y = otfp; y < l; y++)
-                {
-                    if(tofind[y] == '\0' || tofind[y] == '\\' || tofind[y] == '/')
-                        break;
-                }
-
-                tfp = y;
-
-                strcat(rootpath, orgname);
-                strcat(rootpath, "\\");
-
-                y = strlen(rootpath);
-                strcat(rootpath, "TRANS.TBL;1");
-
-                bzero(transtbl, 0x4000);
-
-                f = fopen(rootpath, "rb");
-
-                if(f == NULL)
-                {
-                    dprintf("Couldn't find %s\n", rootpath);
-                    exit_loop = 1;
-                    continue;
-                }
-
-                rootpath[y] = 0;
-
-                fseek(f, 0, SEEK_END);
-                s = ftell(f);
-                fseek(f, 0, SEEK_SET);
-                fread(transtbl, 1, s, f);
-                fclose(f);
-
-                x = 0;
-            }
-        }
-    }
-
-    return filename_found;
-}
-
 int isupper(int c)
 {
     return (c >= 'A' && c <= 'Z');
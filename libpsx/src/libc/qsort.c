@@ -1,65 +1,224 @@
-//  quickSort
-//
-//  This public-domain C implementation by Darel Rex Finley.
-//
-// Modified by Giuseppe Gatta 
+/*
+ * qsort.c
+ *
+ * Part of the PSXSDK C library
+ *
+ * qsort() is an introsort: quicksort with a median of three pivot, which
+ * switches to heapsort when the partitions stay unbalanced, so that the worst
+ * case is O(n log n), and to insertion sort for small partitions.
+ */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *)) 
+// Partitions of this many elements or fewer are left to insertion sort
+#define QSORT_CUTOFF		16
+
+// How elements are swapped, chosen once from the element size and alignment
+enum
 {
-  #define  QSORT_MAX_LEVELS  300
-	
-	
-	int  beg[QSORT_MAX_LEVELS], end[QSORT_MAX_LEVELS], i=0, L, R, swap ;
-	char piv[size];
-	
-	beg[0]=0; end[0]=nmemb;
-	
-	while (i>=0) 
+	QSORT_SWAP_WORD,	// One aligned 32-bit word
+	QSORT_SWAP_DWORD,	// Two aligned 32-bit words
+	QSORT_SWAP_WORDS,	// Any multiple of four bytes, aligned
+	QSORT_SWAP_BYTES
+};
+
+typedef unsigned int __attribute__((may_alias)) qsort_word;
+
+typedef struct
+{
+	size_t size;
+	int swap;
+	int (*compar)(const void *, const void *);
+}qsort_info;
+
+static inline void qsort_swap(char *a, char *b, const qsort_info *q)
+{
+	qsort_word *wa = (qsort_word*)a;
+	qsort_word *wb = (qsort_word*)b;
+	unsigned int t;
+	size_t n;
+	char c;
+
+	switch(q->swap)
 	{
-		L=beg[i]; R=end[i]-1;
-		
-		if (L<R) 
-		{
-			memcpy(piv, base + (size * L), size);
-						
-			while (L<R) 
+		case QSORT_SWAP_WORD:
+			t = wa[0]; wa[0] = wb[0]; wb[0] = t;
+		break;
+
+		case QSORT_SWAP_DWORD:
+			t = wa[0]; wa[0] = wb[0]; wb[0] = t;
+			t = wa[1]; wa[1] = wb[1]; wb[1] = t;
+		break;
+
+		case QSORT_SWAP_WORDS:
+			for(n = q->size / 4; n > 0; n--, wa++, wb++)
 			{
-				while(compar(base + (R*size), piv) > 0 && L<R) R--;
-				
-				if (L<R) 
-				{
-					memcpy(base + (size *L), base + (size * R), size);
-					L++;
-				}
-				
-				while(compar(base + (L*size), piv) <= 0 && L<R) L++;
-				
-				if (L<R)
-				{
-					memcpy(base + (size *R), base + (size * L), size);
-					R--;
-				}
+				t = *wa;
+				*wa = *wb;
+				*wb = t;
 			}
-			
-			memcpy(base + (size*L), piv, size);
-			
-			beg[i+1]=L+1; 
-			end[i+1]=end[i];
-			end[i++]=L;
-			
-			if (end[i]-beg[i]>end[i-1]-beg[i-1])
+		break;
+
+		default:
+			for(n = q->size; n > 0; n--, a++, b++)
 			{
-				swap=beg[i]; beg[i]=beg[i-1]; beg[i-1]=swap;
-				swap=end[i]; end[i]=end[i-1]; end[i-1]=swap; 
+				c = *a;
+				*a = *b;
+				*b = c;
 			}
+		break;
+	}
+}
+
+static void qsort_insertion(char *base, size_t nmemb, const qsort_info *q)
+{
+	char *end = base + (nmemb * q->size);
+	char *i, *j;
+
+	for(i = base + q->size; i < end; i += q->size)
+		for(j = i; j > base && q->compar(j - q->size, j) > 0; j -= q->size)
+			qsort_swap(j - q->size, j, q);
+}
+
+static void qsort_sift_down(char *base, size_t root, size_t nmemb, const qsort_info *q)
+{
+	size_t child;
+
+	while((child = (root * 2) + 1) < nmemb)
+	{
+		if(child + 1 < nmemb &&
+			q->compar(base + (child * q->size), base + ((child + 1) * q->size)) < 0)
+			child++;
+
+		if(q->compar(base + (root * q->size), base + (child * q->size)) >= 0)
+			return;
+
+		qsort_swap(base + (root * q->size), base + (child * q->size), q);
+		root = child;
+	}
+}
+
+static void qsort_heap(char *base, size_t nmemb, const qsort_info *q)
+{
+	size_t x;
+
+	for(x = nmemb / 2; x > 0; x--)
+		qsort_sift_down(base, x - 1, nmemb, q);
+
+	for(x = nmemb - 1; x > 0; x--)
+	{
+		qsort_swap(base, base + (x * q->size), q);
+		qsort_sift_down(base, 0, x, q);
+	}
+}
+
+// Sorts the first, middle and last elements, then moves the median of the three to the first one
+
+static void qsort_pivot(char *base, char *mid, char *last, const qsort_info *q)
+{
+	if(q->compar(mid, base) < 0)
+		qsort_swap(mid, base, q);
+
+	if(q->compar(last, mid) < 0)
+	{
+		qsort_swap(last, mid, q);
+
+		if(q->compar(mid, base) < 0)
+			qsort_swap(mid, base, q);
+	}
+
+	qsort_swap(base, mid, q);
+}
+
+static void qsort_intro(char *base, size_t nmemb, int depth, const qsort_info *q)
+{
+	size_t size = q->size;
+	size_t left, right;
+	char *last, *i, *j;
+
+	while(nmemb > QSORT_CUTOFF)
+	{
+		if(depth-- == 0)
+		{
+			qsort_heap(base, nmemb, q);
+			return;
+		}
+
+		last = base + ((nmemb - 1) * size);
+
+		// The pivot is kept in the first element while partitioning
+		qsort_pivot(base, base + ((nmemb / 2) * size), last, q);
+
+		// Both scans stop on elements equal to the pivot, so that many equal
+		// elements still split in two halves of about the same size
+		i = base + size;
+		j = last;
+
+		for(;;)
+		{
+			while(i <= j && q->compar(i, base) < 0)
+				i += size;
+
+			while(i <= j && q->compar(j, base) > 0)
+				j -= size;
+
+			if(i >= j)
+				break;
+
+			qsort_swap(i, j, q);
+			i += size;
+			j -= size;
 		}
-		else 
+
+		qsort_swap(base, j, q);
+
+		left = (j - base) / size;
+		right = nmemb - left - 1;
+
+		// Recurse on the smaller side and loop on the bigger one,
+		// so that the stack never gets deeper than log2(nmemb)
+		if(left < right)
+		{
+			qsort_intro(base, left, depth, q);
+			base = j + size;
+			nmemb = right;
+		}
+		else
 		{
-			i--; 
+			qsort_intro(j + size, right, depth, q);
+			nmemb = left;
 		}
 	}
+
+	qsort_insertion(base, nmemb, q);
+}
+
+void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	qsort_info q;
+	size_t n;
+	int depth = 0;
+
+	if(nmemb < 2 || size == 0)
+		return;
+
+	q.size = size;
+	q.compar = compar;
+
+	if((((unsigned long)base) & 3) || (size & 3))
+		q.swap = QSORT_SWAP_BYTES;
+	else if(size == 4)
+		q.swap = QSORT_SWAP_WORD;
+	else if(size == 8)
+		q.swap = QSORT_SWAP_DWORD;
+	else
+		q.swap = QSORT_SWAP_WORDS;
+
+	// Heapsort takes over after 2 * log2(nmemb) levels of bad pivots
+	for(n = nmemb; n > 1; n >>= 1)
+		depth += 2;
+
+	qsort_intro((char*)base, nmemb, depth, &q);
 }
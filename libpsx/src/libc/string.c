@@ -10,14 +10,159 @@
 #include <unistd.h>
 #include <ctype.h>
 
-void *memcpy(void *dst, const void *src, size_t len)
+/*
+ * The mem*() functions work on 32-bit words once the destination is aligned.
+ * Reading a word from an address which is not aligned through string_uword
+ * makes GCC use the lwl/lwr instruction pair on MIPS.
+ */
+
+typedef unsigned int __attribute__((may_alias)) string_word;
+
+typedef struct
 {
-	void *dst2 = dst;
-	
+	unsigned int w;
+}__attribute__((packed, may_alias)) string_uword;
+
+#define STRING_MISALIGNED(p)	(((unsigned long)(p)) & 3)
+
+/*
+ * The str*() functions and memchr() scan a word at a time as well.
+ * STRING_HASZERO() is not zero if any byte of the word is zero, and
+ * STRING_REPEAT() copies a byte to the four bytes of a word, so that
+ * STRING_HASZERO(w ^ STRING_REPEAT(c)) finds c.
+ * Aligned words never cross the end of the memory a string is in, so reading
+ * the bytes after the terminator in the same word is safe.
+ */
+
+#define STRING_HASZERO(w)	(((w) - 0x01010101) & ~(w) & 0x80808080)
+#define STRING_REPEAT(c)	(((unsigned char)(c)) * 0x01010101u)
+
+static void string_copy_forward(unsigned char *d, const unsigned char *s, size_t len)
+{
+	string_word *dw;
+
+	if(len >= 8)
+	{
+		while(STRING_MISALIGNED(d))
+		{
+			*(d++) = *(s++);
+			len--;
+		}
+
+		dw = (string_word*)d;
+
+		if(!STRING_MISALIGNED(s))
+		{
+			const string_word *sw = (const string_word*)s;
+
+			for(; len >= 16; len -= 16, dw += 4, sw += 4)
+			{
+				dw[0] = sw[0];
+				dw[1] = sw[1];
+				dw[2] = sw[2];
+				dw[3] = sw[3];
+			}
+
+			for(; len >= 4; len -= 4)
+				*(dw++) = *(sw++);
+
+			s = (const unsigned char*)sw;
+		}
+		else
+		{
+			const string_uword *sw = (const string_uword*)s;
+
+			for(; len >= 16; len -= 16, dw += 4, sw += 4)
+			{
+				dw[0] = sw[0].w;
+				dw[1] = sw[1].w;
+				dw[2] = sw[2].w;
+				dw[3] = sw[3].w;
+			}
+
+			for(; len >= 4; len -= 4)
+				*(dw++) = (sw++)->w;
+
+			s = (const unsigned char*)sw;
+		}
+
+		d = (unsigned char*)dw;
+	}
+
 	while(len--)
-		*(((unsigned char*)dst++)) = *(((unsigned char*)src++));
-		
-	return dst2;
+		*(d++) = *(s++);
+}
+
+// Copies starting from the end, for memmove() when dst overlaps the end of src.
+
+static void string_copy_backward(unsigned char *d, const unsigned char *s, size_t len)
+{
+	string_word *dw;
+
+	d += len;
+	s += len;
+
+	if(len >= 8)
+	{
+		while(STRING_MISALIGNED(d))
+		{
+			*(--d) = *(--s);
+			len--;
+		}
+
+		dw = (string_word*)d;
+
+		if(!STRING_MISALIGNED(s))
+		{
+			const string_word *sw = (const string_word*)s;
+
+			for(; len >= 16; len -= 16)
+			{
+				dw -= 4;
+				sw -= 4;
+				dw[3] = sw[3];
+				dw[2] = sw[2];
+				dw[1] = sw[1];
+				dw[0] = sw[0];
+			}
+
+			for(; len >= 4; len -= 4)
+				*(--dw) = *(--sw);
+
+			s = (const unsigned char*)sw;
+		}
+		else
+		{
+			const string_uword *sw = (const string_uword*)s;
+
+			for(; len >= 16; len -= 16)
+			{
+				dw -= 4;
+				sw -= 4;
+				dw[3] = sw[3].w;
+				dw[2] = sw[2].w;
+				dw[1] = sw[1].w;
+				dw[0] = sw[0].w;
+			}
+
+			for(; len >= 4; len -= 4)
+				*(--dw) = (--sw)->w;
+
+			s = (const unsigned char*)sw;
+		}
+
+		d = (unsigned char*)dw;
+	}
+
+	while(len--)
+		*(--d) = *(--s);
+}
+
+void *memcpy(void *dst, const void *src, size_t len)
+{
+	string_copy_forward((unsigned char*)dst, (const unsigned char*)src, len);
+
+	return dst;
 }
 
 void *memccpy(void *dst, const void *src, int c, size_t len)
@@ -38,50 +183,121 @@ void *memccpy(void *dst, const void *src, int c, size_t len)
 void *memset(void *dst , char c , size_t n)
 {
 	unsigned char *dstc = (unsigned char*)dst;
-	int x;
+	unsigned int w;
+	string_word *dw;
+
+	if(n >= 8)
+	{
+		while(STRING_MISALIGNED(dstc))
+		{
+			*(dstc++) = c;
+			n--;
+		}
+
+		w = (unsigned char)c;
+		w |= w << 8;
+		w |= w << 16;
+
+		dw = (string_word*)dstc;
+
+		for(; n >= 16; n -= 16, dw += 4)
+		{
+			dw[0] = w;
+			dw[1] = w;
+			dw[2] = w;
+			dw[3] = w;
+		}
+
+		for(; n >= 4; n -= 4)
+			*(dw++) = w;
+
+		dstc = (unsigned char*)dw;
+	}
+
+	while(n--)
+		*(dstc++) = c;
 
-	for(x = 0; x < n; x++)
-		dstc[x] = c;
-	
 	return dst;
 }
 
 int memcmp(const void *b1, const void *b2, size_t n)
 {
-	int x;
-	unsigned char *bp1 = (unsigned char*)b1;
-	unsigned char *bp2 = (unsigned char*)b2;
-	
-	for(x = 0;  x < n; x++)
-		if(bp1[x] != bp2[x])
-			return (bp1[x] - bp2[x]);
-		
+	const unsigned char *bp1 = (const unsigned char*)b1;
+	const unsigned char *bp2 = (const unsigned char*)b2;
+
+	if(n >= 8)
+	{
+		while(STRING_MISALIGNED(bp1))
+		{
+			if(*bp1 != *bp2)
+				return (*bp1 - *bp2);
+
+			bp1++;
+			bp2++;
+			n--;
+		}
+
+		// Skip the words which are equal, the first difference is then found byte by byte.
+		if(!STRING_MISALIGNED(bp2))
+		{
+			for(; n >= 4; n -= 4, bp1 += 4, bp2 += 4)
+			{
+				if(*(const string_word*)bp1 != *(const string_word*)bp2)
+					break;
+			}
+		}
+		else
+		{
+			for(; n >= 4; n -= 4, bp1 += 4, bp2 += 4)
+			{
+				if(*(const string_word*)bp1 != ((const string_uword*)bp2)->w)
+					break;
+			}
+		}
+	}
+
+	for(; n > 0; n--, bp1++, bp2++)
+		if(*bp1 != *bp2)
+			return (*bp1 - *bp2);
+
 	return 0;
 }
 
 void *memmove(void *dst, const void *src, size_t len)
 {
-	void *dst2 = dst;
-	
-	dst+=len-1;
-	src+=len-1;
-	
-	while(len--)
-		*(((unsigned char*)dst--)) = *(((unsigned char*)src--));
-		
-	return dst2;
+	unsigned char *d = (unsigned char*)dst;
+	const unsigned char *s = (const unsigned char*)src;
+
+	// Copying forward is safe unless dst starts inside src.
+	if(d <= s || d >= (s + len))
+		string_copy_forward(d, s, len);
+	else
+		string_copy_backward(d, s, len);
+
+	return dst;
 }
 
 void *memchr(void *s , int c , size_t n)
 {
-	while(n--)
-	{
-		if(*((unsigned char*)s) == (unsigned char)c)
-			return s;
-		
-		s++;
-	}
-	
+	const unsigned char *p = (const unsigned char*)s;
+	const string_word *w;
+	unsigned int m;
+
+	c = (unsigned char)c;
+
+	for(; n > 0 && STRING_MISALIGNED(p); n--, p++)
+		if(*p == c)
+			return (void*)p;
+
+	m = STRING_REPEAT(c);
+
+	for(w = (const string_word*)p; n >= 4 && !STRING_HASZERO(*w ^ m); n -= 4)
+		w++;
+
+	for(p = (const unsigned char*)w; n > 0; n--, p++)
+		if(*p == c)
+			return (void*)p;
+
 	return NULL;
 }
 
@@ -110,31 +326,84 @@ char *strcpy(char *dst, const char *src)
 
 int strlen(const char *str)
 {
-	int i = 0;
-	while(*(str++))i++;
-	return i;
+	const char *s = str;
+	const string_word *w;
+
+	for(; STRING_MISALIGNED(s); s++)
+		if(*s == 0)
+			return s - str;
+
+	for(w = (const string_word*)s; !STRING_HASZERO(*w); w++);
+
+	for(s = (const char*)w; *s; s++);
+
+	return s - str;
 }
 
 char *strchr(const char *s, int c)
 {
-	int x;
-	int l = strlen(s);
+	const string_word *w;
+	unsigned int m;
 
-	for(x = 0; x <= l; x++)
-		if(s[x] == c) return (char*)&s[x];
+	c = (char)c;
 
-	return NULL;
+	for(; STRING_MISALIGNED(s); s++)
+	{
+		if(*s == c)
+			return (char*)s;
+
+		if(*s == 0)
+			return NULL;
+	}
+
+	m = STRING_REPEAT(c);
+
+	for(w = (const string_word*)s; !STRING_HASZERO(*w) && !STRING_HASZERO(*w ^ m); w++);
+
+	for(s = (const char*)w; *s != c; s++)
+		if(*s == 0)
+			return NULL;
+
+	return (char*)s;
 }
 
 char *strrchr(const char *s, int c)
 {
-	int x;
-	int l = strlen(s);
+	const char *last = NULL;
+	const string_word *w;
+	unsigned int m;
 
-	for(x = l; x>=0; x--)
-		if(s[x] == c) return (char*)&s[x];
+	c = (char)c;
 
-	return NULL;
+	for(; STRING_MISALIGNED(s); s++)
+	{
+		if(*s == c)
+			last = s;
+
+		if(*s == 0)
+			return (char*)last;
+	}
+
+	m = STRING_REPEAT(c);
+	w = (const string_word*)s;
+
+	for(;;)
+	{
+		// Skip the words with neither c nor the terminator
+		while(!STRING_HASZERO(*w) && !STRING_HASZERO(*w ^ m))
+			w++;
+
+		for(s = (const char*)w; s < (const char*)(w + 1); s++)
+		{
+			if(*s == c)
+				last = s;
+
+			if(*s == 0)
+				return (char*)last;
+		}
+
+		w++;
+	}
 }
 
 char *strpbrk(const char *s, const char *charset)
@@ -169,13 +438,32 @@ char *strstr(const char *big, const char *little)
 
 int strcmp(const char *s1, const char *s2)
 {
-	while(*s1 && *s2 && (*s1 == *s2))
+	const string_word *w1, *w2;
+
+	// Compare words only when both strings can be aligned at the same time
+	if(STRING_MISALIGNED(s1) == STRING_MISALIGNED(s2))
+	{
+		for(; STRING_MISALIGNED(s1); s1++, s2++)
+			if(*s1 == 0 || *s1 != *s2)
+				goto bytes;
+
+		w1 = (const string_word*)s1;
+		w2 = (const string_word*)s2;
+
+		for(; *w1 == *w2 && !STRING_HASZERO(*w1); w1++, w2++);
+
+		s1 = (const char*)w1;
+		s2 = (const char*)w2;
+	}
+
+bytes:
+	while(*s1 && (*s1 == *s2))
 	{
 		s1++;
 		s2++;
 	}
 
-	return *s1-*s2;
+	return *(const unsigned char*)s1 - *(const unsigned char*)s2;
 }
 
 int strncmp(const char *s1, const char *s2, size_t len)
@@ -623,12 +911,19 @@ long atol(const char *string)
 
 int strnlen(const char *s, size_t maxlen)
 {
-	int l=0;
-	
-	while(*(s++) && l<maxlen)
-		l++;
-	
-	return l;
+	const char *p = s;
+	const string_word *w;
+
+	for(; maxlen > 0 && STRING_MISALIGNED(p); maxlen--, p++)
+		if(*p == 0)
+			return p - s;
+
+	for(w = (const string_word*)p; maxlen >= 4 && !STRING_HASZERO(*w); maxlen -= 4)
+		w++;
+
+	for(p = (const char*)w; maxlen > 0 && *p; maxlen--, p++);
+
+	return p - s;
 }
 
 void *memrchr(void *b, int c, size_t len)
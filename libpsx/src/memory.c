@@ -1,4 +1,4 @@
-/* 
+/*
  * memory.c
  *
  * PSXSDK malloc() family functions
@@ -7,209 +7,677 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <psxmem.h>
 
 extern int __bss_start[];
 extern int __bss_end[];
 
-unsigned int first_free_page;
-
-// 1K granularity and "pages", so more allocations which are small can be done
-
-unsigned char busy_pages[2048];
-unsigned int  alloc_size[2048];
-
 // RAM memory map on the PSX
 // 0x80000000 - 0x8000FFFF		RAM used by the BIOS
 // 0x80010000 - 0x801FFFFF		Program memory
 
-void malloc_setup()
+// The heap goes from the end of BSS up to the stack, which starts
+// at 0x801FFF00 and grows downwards; HEAP_STACK_RESERVE bytes are left to it.
+
+#define HEAP_RAM_END			0x80200000
+#define HEAP_STACK_RESERVE		0x8000
+
+// Two level segregated fit (TLSF) allocator.
+// Free blocks are kept in lists by size class: the first level is the
+// power of two of the size, the second level splits it in HEAP_SL_COUNT
+// linear ranges. Two bitmaps tell which lists are not empty, so finding a
+// block which is big enough and freeing one are done in constant time.
+
+#define HEAP_ALIGN_LOG2			3
+#define HEAP_ALIGN			(1 << HEAP_ALIGN_LOG2)
+#define HEAP_SL_LOG2			4
+#define HEAP_SL_COUNT			(1 << HEAP_SL_LOG2)
+#define HEAP_FL_SHIFT			(HEAP_SL_LOG2 + HEAP_ALIGN_LOG2)
+#define HEAP_FL_MAX			21 // Blocks are smaller than 2 megabytes
+#define HEAP_FL_COUNT			(HEAP_FL_MAX - HEAP_FL_SHIFT + 2)
+#define HEAP_SMALL_SIZE			(1 << HEAP_FL_SHIFT)
+
+// Flags in the low bits of the block size
+#define HEAP_BLOCK_FREE			1
+#define HEAP_BLOCK_DEBUG		2 // Block ends with a heap_debug record
+
+// Every block starts with its header; used blocks are followed by the
+// data returned by malloc(), free blocks by their links in the free lists.
+
+typedef struct heap_block
 {
-	int x;
+	struct heap_block *prev_phys; // Previous block in memory, NULL for the first
+	unsigned int size; // Size of the block, header included, and flags
+	struct heap_block *next_free;
+	struct heap_block *prev_free;
+}heap_block;
 
-	dprintf("malloc setup.\n");
+// Allocation record, kept at the end of used blocks in debug mode.
+
+typedef struct
+{
+	void *caller; // Return address of the call to malloc(), calloc() or realloc()
+	unsigned int size; // Requested size
+	unsigned int seq; // Allocation sequence number
+	unsigned int pad;
+}heap_debug;
+
+#define HEAP_HEADER_SIZE		8
+#define HEAP_MIN_BLOCK			sizeof(heap_block)
+
+#define block_size(b)			((b)->size & ~(HEAP_ALIGN - 1))
+#define block_is_free(b)		((b)->size & HEAP_BLOCK_FREE)
+#define block_next(b)			((heap_block*)((unsigned char*)(b) + block_size(b)))
+#define block_data(b)			((void*)((unsigned char*)(b) + HEAP_HEADER_SIZE))
+#define block_from_data(p)		((heap_block*)((unsigned char*)(p) - HEAP_HEADER_SIZE))
+#define block_debug(b)			((heap_debug*)((unsigned char*)block_next(b) - sizeof(heap_debug)))
+
+static unsigned int heap_fl_bitmap;
+static unsigned int heap_sl_bitmap[HEAP_FL_COUNT];
+static heap_block *heap_free_lists[HEAP_FL_COUNT][HEAP_SL_COUNT];
 
-	first_free_page = (unsigned int) __bss_end;
-	first_free_page-= 0x80000000;
-	
-	if(first_free_page & 0x3ff)
-		first_free_page = (first_free_page | 0x3ff) + 1;
+static unsigned char *heap_start;
+static unsigned char *heap_end;
 
-	first_free_page>>=10;
+static unsigned int heap_used;
+static unsigned int heap_peak;
+static unsigned int heap_allocations;
+static unsigned int heap_total_allocations;
+static unsigned int heap_failures;
+static unsigned int heap_seq;
+static int heap_debug_mode;
 
-	//printf("First free page: %d, bss_end: %x\n", first_free_page, __bss_end);
-	
-	for(x = 0; x < first_free_page; x++)
+// Returns the index of the most significant bit set, -1 if none is set.
+// The R3000 has no instruction for it, so do a binary search.
+
+static int heap_fls(unsigned int x)
+{
+	int bit = 31;
+
+	if(x == 0)
+		return -1;
+
+	if(!(x & 0xffff0000)) { x <<= 16; bit -= 16; }
+	if(!(x & 0xff000000)) { x <<= 8; bit -= 8; }
+	if(!(x & 0xf0000000)) { x <<= 4; bit -= 4; }
+	if(!(x & 0xc0000000)) { x <<= 2; bit -= 2; }
+	if(!(x & 0x80000000)) { bit -= 1; }
+
+	return bit;
+}
+
+// Returns the index of the least significant bit set, -1 if none is set.
+
+static int heap_ffs(unsigned int x)
+{
+	return heap_fls(x & (~x + 1));
+}
+
+// Gets the free list where a block of the specified size belongs.
+
+static void heap_mapping_insert(unsigned int size, int *fl, int *sl)
+{
+	if(size < HEAP_SMALL_SIZE)
 	{
-		busy_pages[x] = 1; // RAM occupied by program, data and BIOS looks always allocated
-		alloc_size[x] = 1; // Fake that 1K was required
+		*fl = 0;
+		*sl = size >> HEAP_ALIGN_LOG2;
 	}
-		
-	for(x = first_free_page; x < 2048; x++)
+	else
 	{
-		busy_pages[x] = 0;
-		alloc_size[x] = 0;
+		int f = heap_fls(size);
+
+		*sl = (size >> (f - HEAP_SL_LOG2)) ^ HEAP_SL_COUNT;
+		*fl = f - (HEAP_FL_SHIFT - 1);
 	}
 }
 
-void *malloc(size_t size)
+// Gets the first free list whose blocks are all at least of the specified size.
+
+static void heap_mapping_search(unsigned int size, int *fl, int *sl)
 {
-	dprintf("malloc(%d)\n", size);
+	if(size >= HEAP_SMALL_SIZE)
+		size += (1 << (heap_fls(size) - HEAP_SL_LOG2)) - 1;
 
-	int x, y;
-	
-// Round size
-
-	if(size & 0x3ff)
-		size = (size | 0x3ff) + 1;
-		
-// Divide it by 1024	
-	size >>= 10;
-	//printf("Allocating %dKb\n", size);
-	
-// Find a free page
-	for(x = 0; x < 2048; x++)
-	{
-		if(busy_pages[x] == 0)
+	heap_mapping_insert(size, fl, sl);
+}
+
+static void heap_insert_block(heap_block *b)
+{
+	int fl, sl;
+
+	heap_mapping_insert(block_size(b), &fl, &sl);
+
+	b->prev_free = NULL;
+	b->next_free = heap_free_lists[fl][sl];
+
+	if(b->next_free != NULL)
+		b->next_free->prev_free = b;
+
+	heap_free_lists[fl][sl] = b;
+	heap_fl_bitmap |= 1 << fl;
+	heap_sl_bitmap[fl] |= 1 << sl;
+
+	b->size |= HEAP_BLOCK_FREE;
+}
+
+static void heap_remove_block(heap_block *b)
+{
+	int fl, sl;
+
+	heap_mapping_insert(block_size(b), &fl, &sl);
+
+	if(b->prev_free != NULL)
+		b->prev_free->next_free = b->next_free;
+	else
+	{
+		heap_free_lists[fl][sl] = b->next_free;
+
+		if(b->next_free == NULL)
 		{
-			// If we find a free page, check how many free pages follow it.
-			// If it's enough for the memory we want to allocate, then return
-			// the pointer to the free page we found, otherwise keep finding
-			
-		//	printf("Page found at %dKb\n", x);
-			
-			for(y = 0; y < size; y++)
-				if(busy_pages[x+y] == 1) goto malloc_keep_finding;
-				
-			// We found the memory we wanted, now make it busy
-			
-			for(y = 0; y < size; y++)
-				busy_pages[x+y] = 1;
-			
-			// Store allocation size, it is essential for free()	
-						
-			alloc_size[x] = size;
-		//	printf("malloc(): alloc_size[%d] = %d\n", x, size);
-				
-			return (void*)((unsigned int)0x80000000 + (x<<10));
+			heap_sl_bitmap[fl] &= ~(1 << sl);
+
+			if(heap_sl_bitmap[fl] == 0)
+				heap_fl_bitmap &= ~(1 << fl);
 		}
-malloc_keep_finding:
-		; // Useless statement to make GCC not bail out...
 	}
-	
-// We couldn't find anything, return NULL
-	return NULL;
+
+	if(b->next_free != NULL)
+		b->next_free->prev_free = b->prev_free;
+
+	b->size &= ~HEAP_BLOCK_FREE;
+}
+
+// Finds a free block of at least the specified size, and takes it out of its list.
+
+static heap_block *heap_find_block(unsigned int size)
+{
+	unsigned int map;
+	int fl, sl;
+	heap_block *b;
+
+	heap_mapping_search(size, &fl, &sl);
+
+	map = (fl < HEAP_FL_COUNT) ? (heap_sl_bitmap[fl] & (~0U << sl)) : 0;
+
+	if(map == 0 && fl < HEAP_FL_COUNT)
+	{
+		// Nothing in this first level, go to the next one which is not empty.
+		map = heap_fl_bitmap & (~0U << (fl + 1));
+
+		if(map != 0)
+		{
+			fl = heap_ffs(map);
+			map = heap_sl_bitmap[fl];
+		}
+	}
+
+	if(map == 0)
+	{
+		// The lists which only hold big enough blocks are empty, but the list
+		// the size belongs to can still have one; this matters when the heap is almost full.
+		heap_mapping_insert(size, &fl, &sl);
+
+		for(b = heap_free_lists[fl][sl]; b != NULL; b = b->next_free)
+		{
+			if(block_size(b) >= size)
+				break;
+		}
+
+		if(b == NULL)
+			return NULL;
+	}
+	else
+	{
+		sl = heap_ffs(map);
+		b = heap_free_lists[fl][sl];
+	}
+
+	heap_remove_block(b);
+
+	return b;
+}
+
+// Splits the used block b so that it is size bytes long,
+// and puts the rest back in the free lists if it is big enough for a block.
+
+static void heap_split_block(heap_block *b, unsigned int size)
+{
+	heap_block *rest;
+	heap_block *next;
+	unsigned int rest_size = block_size(b) - size;
+
+	if(rest_size < HEAP_MIN_BLOCK)
+		return;
+
+	rest = (heap_block*)((unsigned char*)b + size);
+	rest->prev_phys = b;
+	rest->size = rest_size;
+	b->size = size | (b->size & (HEAP_ALIGN - 1));
+
+	next = block_next(rest);
+	next->prev_phys = rest;
+
+	// The block after the rest could be free too.
+	if(block_is_free(next))
+	{
+		heap_remove_block(next);
+		rest->size += block_size(next);
+		block_next(rest)->prev_phys = rest;
+	}
+
+	heap_insert_block(rest);
+}
+
+// Converts a requested size to the size of the block which can hold it, 0 if too big.
+
+static unsigned int heap_block_size(size_t size, int debug)
+{
+	if(size > (unsigned int)(heap_end - heap_start))
+		return 0;
+
+	if(debug)
+		size += sizeof(heap_debug);
+
+	size = (size + HEAP_HEADER_SIZE + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+
+	if(size < HEAP_MIN_BLOCK)
+		size = HEAP_MIN_BLOCK;
+
+	return size;
+}
+
+// Checks that ptr was returned by malloc() and was not freed yet.
+
+static int heap_valid_pointer(void *ptr)
+{
+	unsigned char *p = (unsigned char*)ptr;
+
+	if(p < (heap_start + HEAP_HEADER_SIZE) || p >= heap_end ||
+		(((unsigned int)p) & (HEAP_ALIGN - 1)))
+		return 0;
+
+	return !block_is_free(block_from_data(p));
+}
+
+// Returns how many bytes the data of a used block can hold.
+
+static unsigned int heap_capacity(heap_block *b)
+{
+	unsigned int capacity = block_size(b) - HEAP_HEADER_SIZE;
+
+	if(b->size & HEAP_BLOCK_DEBUG)
+		capacity -= sizeof(heap_debug);
+
+	return capacity;
+}
+
+// Accounts for a block which was just allocated, and records who allocated it.
+
+static void heap_account_alloc(heap_block *b, size_t size, void *caller)
+{
+	heap_used += block_size(b);
+	heap_allocations++;
+	heap_total_allocations++;
+	heap_seq++;
+
+	if(heap_used > heap_peak)
+		heap_peak = heap_used;
+
+	if(heap_debug_mode)
+	{
+		heap_debug *d;
+
+		b->size |= HEAP_BLOCK_DEBUG;
+
+		d = block_debug(b);
+		d->caller = caller;
+		d->size = size;
+		d->seq = heap_seq;
+	}
+}
+
+static void *heap_malloc(size_t size, void *caller)
+{
+	unsigned int bsize = heap_block_size(size, heap_debug_mode);
+	heap_block *b;
+
+	if(bsize == 0)
+	{
+		heap_failures++;
+		return NULL;
+	}
+
+	b = heap_find_block(bsize);
+
+	if(b == NULL)
+	{
+		heap_failures++;
+		return NULL;
+	}
+
+	heap_split_block(b, bsize);
+	heap_account_alloc(b, size, caller);
+
+	return block_data(b);
+}
+
+void malloc_setup()
+{
+	heap_block *b;
+	heap_block *sentinel;
+	unsigned int start, end;
+	int x, y;
+
+	dprintf("malloc setup.\n");
+
+	start = (unsigned int) __bss_end;
+	start = (start + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+	end = HEAP_RAM_END - HEAP_STACK_RESERVE;
+
+	heap_start = (unsigned char*)start;
+	heap_end = (unsigned char*)end;
+
+	heap_fl_bitmap = 0;
+
+	for(x = 0; x < HEAP_FL_COUNT; x++)
+	{
+		heap_sl_bitmap[x] = 0;
+
+		for(y = 0; y < HEAP_SL_COUNT; y++)
+			heap_free_lists[x][y] = NULL;
+	}
+
+	// One free block spanning the whole heap, followed by an empty used block
+	// which stops coalescing at the end of the heap.
+
+	sentinel = (heap_block*)(end - HEAP_HEADER_SIZE);
+
+	b = (heap_block*)start;
+	b->prev_phys = NULL;
+	b->size = (end - start) - HEAP_HEADER_SIZE;
+
+	sentinel->prev_phys = b;
+	sentinel->size = 0;
+
+	heap_insert_block(b);
+
+	heap_used = 0;
+	heap_peak = 0;
+	heap_allocations = 0;
+	heap_total_allocations = 0;
+	heap_failures = 0;
+
+	//printf("Heap: %x - %x\n", start, end);
+}
+
+void *malloc(size_t size)
+{
+	dprintf("malloc(%d)\n", size);
+
+	return heap_malloc(size, __builtin_return_address(0));
 }
 
 void *calloc(size_t number, size_t size)
 {
-	void *ptr = malloc(number * size);
-	unsigned char *cptr = (unsigned char*)ptr;
-	int x;
-	
+	void *ptr;
+
+	if(size != 0 && number > (0xffffffff / size))
+		return NULL;
+
+	ptr = heap_malloc(number * size, __builtin_return_address(0));
+
 	if(ptr == NULL)
 		return NULL;
-		
-	for(x = 0; x < (number * size); x++)
-		cptr[x] = 0;
-		
+
+	memset(ptr, 0, number * size);
+
 	return ptr;
-}																
+}
 
 void free(void *ptr)
 {
 	dprintf("free(%x)\n", (unsigned int)ptr);
 
-	unsigned int ptri = (unsigned int)ptr;
-	ptri -= 0x80000000;
-	int x;
-	
-	if((ptri & 0x3ff) || (busy_pages[ptri>>10] == 0) || (alloc_size[ptri>>10] == 0))
+	heap_block *b;
+	heap_block *next;
+
+	if(ptr == NULL)
+		return;
+
+	if(!heap_valid_pointer(ptr))
 	{
-		// If the pointer address is not a multiplier of 1K, or the page
+		// If the pointer is outside the heap, not aligned, or its block
 		// is free, it means that memory not allocated by malloc() was passed to free.
 		// Print a warning message and return.
-		
+
 		printf("** free() ** : tried to free memory with invalid pointer at %x\n",
-			ptri + 0x80000000);
-			
-		return;	
+			(unsigned int)ptr);
+
+		return;
 	}
-	
-// Divide ptri by 1024, getting initial page
-	
-	ptri>>=10;
 
-//	printf("Freeing page at %dKb\n", ptri);
+	b = block_from_data(ptr);
+
+	heap_used -= block_size(b);
+	heap_allocations--;
+	b->size &= ~HEAP_BLOCK_DEBUG;
 
-// Free pages
+	// Merge with the free blocks before and after this one.
+
+	if(b->prev_phys != NULL && block_is_free(b->prev_phys))
+	{
+		heap_block *prev = b->prev_phys;
+
+		heap_remove_block(prev);
+		prev->size += block_size(b);
+		b = prev;
+	}
 
-//	printf("alloc_size[%d] = %d\n", ptri, alloc_size[ptri]);
+	next = block_next(b);
 
-	for(x = 0; x < alloc_size[ptri]; x++)
+	if(block_is_free(next))
 	{
-		dprintf("ptri + x = %d\n", ptri + x);
-		busy_pages[ptri + x] = 0;
+		heap_remove_block(next);
+		b->size += block_size(next);
+		next = block_next(b);
 	}
 
-// Set allocation size to 0, finally freeing initial page		
-						
-	alloc_size[ptri] = 0;
-	
-	/*for(x=150;x<170;x++)
-		printf("%d: %d, %d\n", x, busy_pages[x], alloc_size[x]);*/
+	next->prev_phys = b;
+
+	heap_insert_block(b);
 }
 
 void *realloc(void *ptr, size_t size)
 {
-	unsigned int ptri = (unsigned int)ptr;
-	int x;
+	heap_block *b;
+	heap_block *next;
+	heap_block *prev;
+	heap_debug rec;
+	unsigned int old_size, old_bsize, bsize, room;
+	int debug;
 	void *newptr;
-	
+
 	if(ptr == NULL)
-		return malloc(size);
-	
-	ptri -= 0x80000000;
-	
-	size |= 0x3ff;
-	size++;
-	
-	size>>=10;
-	
-	if((ptri & 0x3ff) || (busy_pages[ptri>>10] == 0) || (alloc_size[ptri>>10] == 0))
-	{
-		// If the pointer address is not a multiplier of 1K, or the page
+		return heap_malloc(size, __builtin_return_address(0));
+
+	if(!heap_valid_pointer(ptr))
+	{
+		// If the pointer is outside the heap, not aligned, or its block
 		// is free, it means that memory not allocated by malloc() was passed to realloc.
 		// Print a warning message and return.
-		
+
 		printf("** realloc() ** : tried to reallocate memory with invalid pointer at %x\n",
-			ptri + 0x80000000);
-			
-		return NULL;	
+			(unsigned int)ptr);
+
+		return NULL;
 	}
 
-// Get page
-	
-	ptri>>=10;
+	b = block_from_data(ptr);
+	debug = b->size & HEAP_BLOCK_DEBUG;
+	old_size = heap_capacity(b);
+	old_bsize = block_size(b);
+	bsize = heap_block_size(size, debug);
 
-	if(size < alloc_size[ptri]) // New size smaller than old size
+	if(bsize == 0)
 	{
-		for(x = size; x < alloc_size[ptri]; x++)
-			busy_pages[ptri + x] = 0;
-	
-		alloc_size[ptri] = size;
+		heap_failures++;
+		return NULL;
+	}
+
+	// The debug record is at the end of the block, which is going to move.
+	if(debug)
+		rec = *block_debug(b);
+
+	next = block_next(b);
+	prev = b->prev_phys;
+	room = old_bsize;
+
+	if(block_is_free(next))
+		room += block_size(next);
+
+	if(bsize <= room)
+	{
+		// Shrink, or grow into the free block which follows.
+		if(bsize > old_bsize)
+		{
+			heap_remove_block(next);
+			b->size += block_size(next);
+			block_next(b)->prev_phys = b;
+		}
+	}
+	else if(prev != NULL && block_is_free(prev) && bsize <= (room + block_size(prev)))
+	{
+		// Grow into the free block before, and the one after if it is free too.
+		heap_remove_block(prev);
+		prev->size = (prev->size & (HEAP_ALIGN - 1)) | (block_size(prev) + old_bsize);
+
+		if(block_is_free(next))
+		{
+			heap_remove_block(next);
+			prev->size += block_size(next);
+		}
+
+		prev->size |= debug;
+		block_next(prev)->prev_phys = prev;
+
+		memmove(block_data(prev), ptr, old_size);
+
+		b = prev;
+		ptr = block_data(b);
 	}
-	else if(size > alloc_size[ptri]) // New size bigger than old size
+	else
 	{
-		newptr = malloc(size * 1024);
-		
+		newptr = heap_malloc(size, __builtin_return_address(0));
+
 		if(newptr == NULL)
 			return NULL;
-		
-		memcpy(newptr, ptr, alloc_size[ptri]);
+
+		memcpy(newptr, ptr, (size < old_size) ? size : old_size);
 		free(ptr);
-		
-		ptr = newptr;
+
+		return newptr;
 	}
-	
+
+	// Give back what is not needed anymore.
+	heap_split_block(b, bsize);
+
+	heap_used += block_size(b) - old_bsize;
+
+	if(heap_used > heap_peak)
+		heap_peak = heap_used;
+
+	if(debug)
+	{
+		*block_debug(b) = rec;
+		block_debug(b)->size = size;
+	}
+
 	return ptr;
 }
+
+void PSX_HeapGetStats(psx_heap_stats *stats)
+{
+	heap_block *b = (heap_block*)heap_start;
+	unsigned int size;
+
+	stats->total = heap_end - heap_start;
+	stats->used = heap_used;
+	stats->free = 0;
+	stats->largest_free = 0;
+	stats->free_blocks = 0;
+	stats->allocations = heap_allocations;
+	stats->total_allocations = heap_total_allocations;
+	stats->failures = heap_failures;
+	stats->peak = heap_peak;
+
+	if(b == NULL)
+		return;
+
+	// Walk the blocks in memory order, up to the empty one at the end.
+	while((size = block_size(b)) != 0)
+	{
+		if(block_is_free(b))
+		{
+			stats->free += size;
+			stats->free_blocks++;
+
+			if(size > stats->largest_free)
+				stats->largest_free = size;
+		}
+
+		b = block_next(b);
+	}
+
+	// Headers are not usable.
+	if(stats->largest_free >= HEAP_HEADER_SIZE)
+		stats->largest_free -= HEAP_HEADER_SIZE;
+}
+
+void PSX_HeapSetDebug(int enabled)
+{
+	heap_debug_mode = enabled;
+}
+
+unsigned int PSX_HeapMark(void)
+{
+	return heap_seq;
+}
+
+void PSX_HeapDump(unsigned int since)
+{
+	psx_heap_stats st;
+	heap_block *b = (heap_block*)heap_start;
+	unsigned int listed = 0;
+
+	PSX_HeapGetStats(&st);
+
+	sio_printf("heap: %u bytes, %u used (peak %u), %u free in %u blocks, largest %u\n",
+		st.total, st.used, st.peak, st.free, st.free_blocks, st.largest_free);
+	sio_printf("heap: %u allocations (%u in total), %u failed\n",
+		st.allocations, st.total_allocations, st.failures);
+
+	// How much of the free memory can not be obtained with a single malloc().
+	if(st.free >= 16)
+		sio_printf("heap: fragmentation %u%%\n", 100 - (((st.largest_free + HEAP_HEADER_SIZE) / 16) * 100) / (st.free / 16));
+
+	// Only blocks allocated in debug mode know their caller.
+	while(block_size(b) != 0)
+	{
+		if(!block_is_free(b) && (b->size & HEAP_BLOCK_DEBUG))
+		{
+			heap_debug *d = block_debug(b);
+
+			if(d->seq > since)
+			{
+				sio_printf("  %08x %8u bytes, #%u from %08x\n", (unsigned int)block_data(b),
+					d->size, d->seq, (unsigned int)d->caller);
+				listed++;
+			}
+		}
+
+		b = block_next(b);
+	}
+
+	if(listed > 0)
+		sio_printf("heap: %u allocations listed\n", listed);
+}
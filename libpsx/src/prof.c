@@ -0,0 +1,347 @@
+/*******************************************************************//**
+*
+* \file     prof.c
+*
+* \brief    PSXSDK frame profiler. Times named scopes with root
+*           counters 1 and 2 and keeps per-frame totals in a ring buffer.
+*
+************************************************************************/
+
+/* *************************************
+ * Includes
+ * *************************************/
+
+#include <psx.h>
+#include <stdio.h>
+#include <string.h>
+
+/* *************************************
+ * Defines
+ * *************************************/
+
+/* Root counter 2 mode: count at system clock / 8, no interrupts. */
+#define PROF_RCNT_MODE          0x0200
+/* Root counter 1 mode: count horizontal blanks, no interrupts. */
+#define PROF_RCNT_HBLANK_MODE   0x0100
+
+/* Ticks in one second and in one video frame. */
+#define PROF_TICKS_PER_SEC      (33868800 / 8)
+#define PROF_TICKS_NTSC         (PROF_TICKS_PER_SEC / 60)
+#define PROF_TICKS_PAL          (PROF_TICKS_PER_SEC / 50)
+/* Ticks in one scanline, about 269 in NTSC and 271 in PAL. */
+#define PROF_TICKS_HBLANK       270
+
+#define PROF_LABEL_CHARS        8
+#define PROF_ROW_HEIGHT         10
+
+/* *************************************
+ * Types definition
+ * *************************************/
+
+typedef struct
+{
+    const char *name;
+    unsigned int start;
+    unsigned int total;
+    int open;
+}prof_scope;
+
+/* *************************************
+ * Local variables definition
+ * *************************************/
+
+static int prof_enabled;
+static unsigned short prof_last;
+static unsigned short prof_last_hblank;
+static unsigned int prof_clock;
+static unsigned int prof_frame_start;
+static prof_scope prof_scopes[PROF_MAX_SCOPES] =
+{
+    {"gpu list"},
+    {"gpu draw"},
+    {"image"},
+};
+static unsigned int prof_nscopes = 3;
+static unsigned int prof_history[PROF_HISTORY][PROF_MAX_SCOPES];
+static unsigned int prof_frame_ticks[PROF_HISTORY];
+static unsigned int prof_slot;
+static unsigned int prof_frames;
+
+static const unsigned char prof_colors[8][3] =
+{
+    {0, 160, 255}, {0, 220, 0}, {255, 200, 0}, {255, 0, 255},
+    {0, 255, 200}, {160, 120, 255}, {255, 128, 64}, {200, 200, 200},
+};
+
+/* *************************************
+ *  Local prototypes declaration
+ * *************************************/
+
+static unsigned int prof_now(void);
+static int prof_frame_slot(int frame);
+static void prof_draw_bar(int x, int y, int w, unsigned int ticks, const unsigned char *color);
+
+/* *************************************
+ * Functions definition
+ * *************************************/
+
+/*
+ * Returns the time in ticks, extending the 16-bit root counter 2 to 32 bits.
+ * Root counter 2 wraps around every 65536 ticks, less than a video frame,
+ * so the scanlines counted by root counter 1 since the last call tell how many
+ * times it did: the scanline count is only off by a tick or two per line, so
+ * it is accurate enough as long as it is called at least once a second.
+ */
+
+static unsigned int prof_now(void)
+{
+    unsigned short h = GetRCnt(RCntCNT1);
+    unsigned short c = GetRCnt(RCntCNT2);
+    unsigned int elapsed = (unsigned short)(c - prof_last);
+    unsigned int coarse = (unsigned short)(h - prof_last_hblank) * PROF_TICKS_HBLANK;
+
+    /* Add the number of whole wraps which brings it nearest to the coarse time. */
+    if (coarse + 32768 > elapsed)
+        elapsed += (coarse + 32768 - elapsed) & 0xffff0000;
+
+    prof_clock += elapsed;
+    prof_last = c;
+    prof_last_hblank = h;
+
+    return prof_clock;
+}
+
+void PSX_ProfInit(void)
+{
+    int x;
+
+    SetRCnt(RCntCNT1, 0xffff, PROF_RCNT_HBLANK_MODE);
+    SetRCnt(RCntCNT2, 0xffff, PROF_RCNT_MODE);
+
+    prof_last_hblank = GetRCnt(RCntCNT1);
+    prof_last = GetRCnt(RCntCNT2);
+    prof_clock = 0;
+    prof_frame_start = 0;
+
+    for (x = 0; x < PROF_MAX_SCOPES; x++)
+    {
+        prof_scopes[x].total = 0;
+        prof_scopes[x].open = 0;
+    }
+
+    prof_slot = 0;
+    prof_frames = 0;
+    prof_enabled = 1;
+}
+
+void PSX_ProfStop(void)
+{
+    prof_enabled = 0;
+}
+
+int PSX_ProfScope(const char *name)
+{
+    int x;
+
+    for (x = 0; x < prof_nscopes; x++)
+    {
+        if (strcmp(prof_scopes[x].name, name) == 0)
+            return x;
+    }
+
+    if (prof_nscopes >= PROF_MAX_SCOPES)
+        return -1;
+
+    prof_scopes[prof_nscopes].name = name;
+    prof_scopes[prof_nscopes].total = 0;
+    prof_scopes[prof_nscopes].open = 0;
+
+    return prof_nscopes++;
+}
+
+void PSX_ProfBegin(int scope)
+{
+    prof_scope *s;
+
+    if (!prof_enabled || scope < 0 || scope >= prof_nscopes)
+        return;
+
+    s = &prof_scopes[scope];
+
+    if (s->open)
+        return;
+
+    s->start = prof_now();
+    s->open = 1;
+}
+
+void PSX_ProfEnd(int scope)
+{
+    prof_scope *s;
+
+    if (!prof_enabled || scope < 0 || scope >= prof_nscopes)
+        return;
+
+    s = &prof_scopes[scope];
+
+    if (!s->open)
+        return;
+
+    s->total += prof_now() - s->start;
+    s->open = 0;
+}
+
+void PSX_ProfFrame(void)
+{
+    unsigned int now;
+    int x;
+
+    if (!prof_enabled)
+        return;
+
+    now = prof_now();
+
+    for (x = 0; x < prof_nscopes; x++)
+    {
+        prof_scope *s = &prof_scopes[x];
+
+        /* Split scopes which are still open at the frame boundary. */
+        if (s->open)
+        {
+            s->total += now - s->start;
+            s->start = now;
+        }
+
+        prof_history[prof_slot][x] = s->total;
+        s->total = 0;
+    }
+
+    prof_frame_ticks[prof_slot] = now - prof_frame_start;
+    prof_frame_start = now;
+
+    prof_slot = (prof_slot + 1) % PROF_HISTORY;
+    prof_frames++;
+}
+
+/*
+ * Returns the history slot of a frame, 0 being the last one, or -1.
+ */
+
+static int prof_frame_slot(int frame)
+{
+    if (frame < 0 || frame >= PROF_HISTORY || frame >= prof_frames)
+        return -1;
+
+    return (prof_slot + PROF_HISTORY - 1 - frame) % PROF_HISTORY;
+}
+
+unsigned int PSX_ProfGetTicks(int scope, int frame)
+{
+    int slot = prof_frame_slot(frame);
+
+    if (slot < 0 || scope >= (int)prof_nscopes)
+        return 0;
+
+    if (scope < 0)
+        return prof_frame_ticks[slot];
+
+    return prof_history[slot][scope];
+}
+
+unsigned int PSX_ProfTicksToUs(unsigned int ticks)
+{
+    /* 1000000 / 4233600 = 625 / 2646, split to avoid overflowing. */
+    return ((ticks / 2646) * 625) + (((ticks % 2646) * 625) / 2646);
+}
+
+void PSX_ProfDump(void)
+{
+    unsigned int n = (prof_frames < PROF_HISTORY) ? prof_frames : PROF_HISTORY;
+    unsigned int sum, max, t;
+    int x, f;
+
+    if (n == 0)
+        return;
+
+    sio_printf("profile of the last %u frames (avg/max us)\n", n);
+
+    for (x = -1; x < (int)prof_nscopes; x++)
+    {
+        sum = 0;
+        max = 0;
+
+        for (f = 0; f < n; f++)
+        {
+            t = PSX_ProfGetTicks(x, f);
+            sum += t;
+
+            if (t > max)
+                max = t;
+        }
+
+        sio_printf("%-12s %8u %8u\n", (x < 0) ? "frame" : prof_scopes[x].name,
+            PSX_ProfTicksToUs(sum / n), PSX_ProfTicksToUs(max));
+    }
+}
+
+static void prof_draw_bar(int x, int y, int w, unsigned int ticks, const unsigned char *color)
+{
+    GsRectangle r;
+    unsigned int frame = (GsScreenM == VMODE_PAL) ? PROF_TICKS_PAL : PROF_TICKS_NTSC;
+    unsigned int len = (ticks * (unsigned int)w) / frame;
+
+    r.y = y;
+    r.h = PROF_ROW_HEIGHT - 2;
+    r.attribute = 0;
+
+    /* Background, the length of one video frame. */
+    r.x = x;
+    r.w = w;
+    r.r = r.g = r.b = 48;
+    GsSortRectangle(&r);
+
+    if (len == 0)
+        return;
+
+    if (len > w)
+    {
+        /* Over budget. */
+        r.r = 255;
+        r.g = r.b = 0;
+    }
+    else
+    {
+        r.w = len;
+        r.r = color[0];
+        r.g = color[1];
+        r.b = color[2];
+    }
+
+    GsSortRectangle(&r);
+}
+
+void PSX_ProfDraw(int x, int y, int w)
+{
+    static const unsigned char frame_color[3] = {255, 255, 255};
+    char label[PROF_LABEL_CHARS + 1];
+    unsigned int ticks, us;
+    int s, bx = x + ((PROF_LABEL_CHARS + 1) * 8);
+
+    if (prof_frame_slot(0) < 0)
+        return;
+
+    for (s = -1; s < (int)prof_nscopes; s++)
+    {
+        ticks = PSX_ProfGetTicks(s, 0);
+        us = PSX_ProfTicksToUs(ticks);
+
+        strncpy(label, (s < 0) ? "frame" : prof_scopes[s].name, PROF_LABEL_CHARS);
+        label[PROF_LABEL_CHARS] = 0;
+
+        GsPrintFont(x, y, "%s", label);
+        prof_draw_bar(bx, y, w, ticks, (s < 0) ? frame_color : prof_colors[s & 7]);
+        GsPrintFont(bx + w + 8, y, "%u.%02u", us / 1000, (us % 1000) / 10);
+
+        y += PROF_ROW_HEIGHT;
+    }
+}
@@ -0,0 +1,187 @@
+/*******************************************************************//**
+*
+* \file     texcache.c
+*
+* \brief    PSXSDK texture residency cache. Keeps track of which
+*           images are in video memory, uploads them when they are
+*           first used and evicts the least recently used ones
+*           when video memory runs out.
+*
+************************************************************************/
+
+/* *************************************
+ * Includes
+ * *************************************/
+
+#include <psx.h>
+#include <stdio.h>
+
+/* *************************************
+ * Local variables definition
+ * *************************************/
+
+static GsTexture *tex_list;
+static unsigned int tex_frame = 1;
+static GsTexCacheStats tex_stats;
+
+/* *************************************
+ *  Local prototypes declaration
+ * *************************************/
+
+static int tex_evict_lru(void);
+static int tex_make_resident(GsTexture *tex);
+
+/* *************************************
+ * Functions definition
+ * *************************************/
+
+int GsTexInit(GsTexture *tex, const void *timdata)
+{
+    GsTexture *t;
+
+    /* The structure may be uninitialized, so only trust it once it is found in the list. */
+    for (t = tex_list; t != NULL; t = t->next)
+    {
+        if (t == tex)
+        {
+            GsTexRelease(tex);
+            break;
+        }
+    }
+
+    if (!GsImageFromTim(&tex->image, timdata))
+        return 0;
+
+    tex->resident = 0;
+    tex->last_use = 0;
+
+    tex->next = tex_list;
+    tex_list = tex;
+
+    return 1;
+}
+
+void GsTexRelease(GsTexture *tex)
+{
+    GsTexture **t;
+
+    if (tex->resident)
+    {
+        GsVramFreeImage(&tex->image);
+        tex->resident = 0;
+    }
+
+    for (t = &tex_list; *t != NULL; t = &(*t)->next)
+    {
+        if (*t == tex)
+        {
+            *t = tex->next;
+            break;
+        }
+    }
+
+    tex->next = NULL;
+}
+
+/*
+ * Evicts the resident texture which was used least recently.
+ * Textures used in the current frame are never evicted, as the
+ * primitives referencing them might not have been drawn yet.
+ */
+
+static int tex_evict_lru(void)
+{
+    GsTexture *t;
+    GsTexture *lru = NULL;
+
+    for (t = tex_list; t != NULL; t = t->next)
+    {
+        if (!t->resident || t->last_use == tex_frame)
+            continue;
+
+        if (lru == NULL || t->last_use < lru->last_use)
+            lru = t;
+    }
+
+    if (lru == NULL)
+        return 0;
+
+    GsVramFreeImage(&lru->image);
+    lru->resident = 0;
+
+    tex_stats.evictions++;
+
+    return 1;
+}
+
+static int tex_make_resident(GsTexture *tex)
+{
+    GsImage *image = &tex->image;
+
+    while (!GsVramAllocImage(image))
+    {
+        if (!tex_evict_lru())
+            return 0;
+    }
+
+    GsUploadImage(image);
+
+    tex->resident = 1;
+
+    tex_stats.uploads++;
+    tex_stats.upload_bytes += image->w * image->h * 2;
+
+    if (image->has_clut)
+        tex_stats.upload_bytes += image->clut_w * image->clut_h * 2;
+
+    return 1;
+}
+
+int GsTexBind(GsTexture *tex, GsSprite *sprite)
+{
+    GsSprite tmp;
+
+    if (tex->resident)
+        tex_stats.hits++;
+    else
+    {
+        tex_stats.misses++;
+
+        if (!tex_make_resident(tex))
+            return 0;
+    }
+
+    tex->last_use = tex_frame;
+
+    if (sprite != NULL)
+    {
+        GsSpriteFromImage(&tmp, &tex->image, 0);
+
+        sprite->tpage = tmp.tpage;
+        sprite->u = tmp.u;
+        sprite->v = tmp.v;
+        sprite->cx = tmp.cx;
+        sprite->cy = tmp.cy;
+    }
+
+    return 1;
+}
+
+void GsTexNextFrame(void)
+{
+    tex_frame++;
+}
+
+void GsTexGetStats(GsTexCacheStats *stats)
+{
+    *stats = tex_stats;
+}
+
+void GsTexResetStats(void)
+{
+    tex_stats.hits = 0;
+    tex_stats.misses = 0;
+    tex_stats.uploads = 0;
+    tex_stats.upload_bytes = 0;
+    tex_stats.evictions = 0;
+}
@@ -0,0 +1,295 @@
+/*******************************************************************//**
+*
+* \file     vram.c
+*
+* \brief    PSXSDK Video RAM region allocator for textures and CLUTs.
+*
+************************************************************************/
+
+/* *************************************
+ * Includes
+ * *************************************/
+
+#include <psx.h>
+#include <stdio.h>
+
+/* *************************************
+ * Defines
+ * *************************************/
+
+#define VRAM_WIDTH                  1024
+#define VRAM_HEIGHT                 512
+#define VRAM_MAX_REGIONS            256
+
+/* Texture pages are 64 halfwords wide and 256 lines high. */
+#define TPAGE_WIDTH                 64
+#define TPAGE_HEIGHT                256
+
+/* CLUTs can only be placed at X coordinates which are a multiple of 16. */
+#define CLUT_ALIGN                  16
+
+/* *************************************
+ * Types definition
+ * *************************************/
+
+typedef struct
+{
+    short x, y;
+    short w, h;
+}vram_region;
+
+/* *************************************
+ * Local variables definition
+ * *************************************/
+
+static vram_region vram_regions[VRAM_MAX_REGIONS];
+static int vram_region_count;
+
+/* *************************************
+ *  Local prototypes declaration
+ * *************************************/
+
+static int vram_is_free(int x, int y, int w, int h);
+static int vram_fits_tpage(int x, int y, int w, int h);
+static int vram_add_region(int x, int y, int w, int h);
+static int vram_find(int w, int h, int align, int texture, int *rx, int *ry);
+
+/* *************************************
+ * Functions definition
+ * *************************************/
+
+static int vram_is_free(int x, int y, int w, int h)
+{
+    int i;
+
+    if (x < 0 || y < 0 || (x + w) > VRAM_WIDTH || (y + h) > VRAM_HEIGHT)
+        return 0;
+
+    for (i = 0; i < vram_region_count; i++)
+    {
+        vram_region *r = &vram_regions[i];
+
+        if (x < (r->x + r->w) && r->x < (x + w) &&
+            y < (r->y + r->h) && r->y < (y + h))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int vram_fits_tpage(int x, int y, int w, int h)
+{
+    /*
+     * A texture has to be reachable from the texture page it starts in:
+     * narrow ones must not cross a page boundary, wide ones must start on one.
+     */
+    if (w <= TPAGE_WIDTH)
+    {
+        if (((x % TPAGE_WIDTH) + w) > TPAGE_WIDTH)
+            return 0;
+    }
+    else if (x % TPAGE_WIDTH)
+        return 0;
+
+    return ((y % TPAGE_HEIGHT) + h) <= TPAGE_HEIGHT;
+}
+
+static int vram_add_region(int x, int y, int w, int h)
+{
+    vram_region *r;
+
+    if (vram_region_count >= VRAM_MAX_REGIONS)
+        return 0;
+
+    r = &vram_regions[vram_region_count++];
+
+    r->x = x;
+    r->y = y;
+    r->w = w;
+    r->h = h;
+
+    return 1;
+}
+
+/*
+ * Top-left placement: candidate positions are the origin and
+ * the right and bottom edges of every allocated region, each of them also
+ * moved forward to the next texture page when the region would straddle one.
+ * The free candidate with the lowest Y, then the lowest X, wins.
+ * Only these edge positions are tried, so an allocation can fail even
+ * though a large enough free area exists elsewhere in VRAM.
+ */
+
+static int vram_find(int w, int h, int align, int texture, int *rx, int *ry)
+{
+    int i, j;
+    int best_x = -1, best_y = -1;
+
+    for (i = -1; i < vram_region_count; i++)
+    {
+        int cand_x[4], cand_y[4];
+
+        if (i < 0)
+        {
+            cand_x[0] = 0;
+            cand_y[0] = 0;
+            cand_x[1] = 0;
+            cand_y[1] = 0;
+        }
+        else
+        {
+            cand_x[0] = vram_regions[i].x + vram_regions[i].w;
+            cand_y[0] = vram_regions[i].y;
+            cand_x[1] = vram_regions[i].x;
+            cand_y[1] = vram_regions[i].y + vram_regions[i].h;
+        }
+
+        for (j = 0; j < 2; j++)
+        {
+            /* Round X up to the required alignment. */
+            cand_x[j] = (cand_x[j] + align - 1) & ~(align - 1);
+
+            cand_x[j + 2] = (cand_x[j] | (TPAGE_WIDTH - 1)) + 1;
+            cand_y[j + 2] = cand_y[j];
+
+            if (texture && !vram_fits_tpage(cand_x[j], cand_y[j], w, h))
+            {
+                if (((cand_y[j] % TPAGE_HEIGHT) + h) > TPAGE_HEIGHT)
+                {
+                    cand_x[j + 2] = cand_x[j];
+                    cand_y[j + 2] = (cand_y[j] | (TPAGE_HEIGHT - 1)) + 1;
+                }
+
+                cand_x[j] = -1;
+            }
+        }
+
+        for (j = 0; j < 4; j++)
+        {
+            if (cand_x[j] < 0)
+                continue;
+
+            if (texture && !vram_fits_tpage(cand_x[j], cand_y[j], w, h))
+                continue;
+
+            if (!vram_is_free(cand_x[j], cand_y[j], w, h))
+                continue;
+
+            if (best_x < 0 || cand_y[j] < best_y ||
+               (cand_y[j] == best_y && cand_x[j] < best_x))
+            {
+                best_x = cand_x[j];
+                best_y = cand_y[j];
+            }
+        }
+    }
+
+    if (best_x < 0)
+        return 0;
+
+    *rx = best_x;
+    *ry = best_y;
+
+    return 1;
+}
+
+void GsVramReset(void)
+{
+    vram_region_count = 0;
+}
+
+int GsVramReserve(int x, int y, int w, int h)
+{
+    if (w <= 0 || h <= 0 || !vram_is_free(x, y, w, h))
+        return 0;
+
+    return vram_add_region(x, y, w, h);
+}
+
+int GsVramAlloc(int w, int h, int *x, int *y)
+{
+    int rx, ry;
+
+    if (w <= 0 || h <= 0 || w > (TPAGE_WIDTH * 4) || h > TPAGE_HEIGHT)
+        return 0;
+
+    if (!vram_find(w, h, 1, 1, &rx, &ry))
+        return 0;
+
+    if (!vram_add_region(rx, ry, w, h))
+        return 0;
+
+    *x = rx;
+    *y = ry;
+
+    return 1;
+}
+
+int GsVramAllocClut(int w, int h, int *x, int *y)
+{
+    int rx, ry;
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    if (!vram_find(w, h, CLUT_ALIGN, 0, &rx, &ry))
+        return 0;
+
+    if (!vram_add_region(rx, ry, w, h))
+        return 0;
+
+    *x = rx;
+    *y = ry;
+
+    return 1;
+}
+
+int GsVramFree(int x, int y)
+{
+    int i;
+
+    for (i = 0; i < vram_region_count; i++)
+    {
+        if (vram_regions[i].x == x && vram_regions[i].y == y)
+        {
+            vram_regions[i] = vram_regions[--vram_region_count];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int GsVramAllocImage(GsImage *image)
+{
+    int x, y;
+    int cx, cy;
+
+    if (!GsVramAlloc(image->w, image->h, &x, &y))
+        return 0;
+
+    if (image->has_clut)
+    {
+        if (!GsVramAllocClut(image->clut_w, image->clut_h, &cx, &cy))
+        {
+            GsVramFree(x, y);
+            return 0;
+        }
+
+        image->clut_x = cx;
+        image->clut_y = cy;
+    }
+
+    image->x = x;
+    image->y = y;
+
+    return 1;
+}
+
+void GsVramFreeImage(GsImage *image)
+{
+    GsVramFree(image->x, image->y);
+
+    if (image->has_clut)
+        GsVramFree(image->clut_x, image->clut_y);
+}
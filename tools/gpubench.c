@@ -0,0 +1,776 @@
+/*
+ * gpubench - measures the cost of building GPU packets with libpsx
+ *
+ * Links libpsx/src/gpu.c against stub registers (gpubench_regs.h) and calls
+ * each GsSort*() function many times, reporting how many packets per second
+ * are built and how many bytes each one takes in the primitive list.
+ * The output is CSV, so that results from different SDK revisions can be compared.
+ * Before that, the results of some functions are checked against a reference,
+ * and primitive lists are drawn with libgpusim and compared with reference checksums;
+ * the exit status is 1 if any check fails.
+ *
+ * Part of PSXSDK
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <stdint.h>
+#include <psx.h>
+#include "gpusim.h"
+
+#define LIST_WORDS		0x40000
+#define LIST_MARGIN		1024
+#define DEFAULT_CALLS		1000000
+#define SIZE_CALLS		64
+#define OT_ENTRIES		16
+#define RASTER_W		320
+#define RASTER_H		240
+
+typedef struct
+{
+	const char *name;
+	void (*sort)(int i);
+}gpubench_test;
+
+typedef struct
+{
+	const char *name;
+	void (*check)(void);
+}gpubench_check;
+
+static volatile unsigned int regs[8];
+static unsigned int list[LIST_WORDS];
+static int failures;
+static int save_raster;
+
+static short pl_x[8] = {0, 40, 80, 120, 160, 200, 240, 280};
+static short pl_y[8] = {10, 60, 10, 60, 10, 60, 10, 60};
+static unsigned char pl_r[8] = {255, 0, 0, 255, 255, 0, 0, 255};
+static unsigned char pl_g[8] = {0, 255, 0, 255, 0, 255, 0, 255};
+static unsigned char pl_b[8] = {0, 0, 255, 255, 0, 0, 255, 255};
+
+volatile unsigned int *gpubench_reg(int r)
+{
+	// Always ready, DMA never busy.
+	regs[1] = (1<<26)|(1<<27)|(1<<28);
+	regs[5] &= ~(1<<24);
+
+	return &regs[r];
+}
+
+unsigned int PSX_GetInitFlags(void)
+{
+	return 0;
+}
+
+// The profiler hooks in gpu.c are not measured.
+void PSX_ProfBegin(int scope)
+{
+}
+
+void PSX_ProfEnd(int scope)
+{
+}
+
+static void bench_poly3(int i)
+{
+	GsPoly3 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 20;
+	p.x[2] = 50; p.y[2] = 100;
+	p.r = 255;
+
+	GsSortPoly3(&p);
+}
+
+static void bench_poly4(int i)
+{
+	GsPoly4 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 10;
+	p.x[2] = i & 63; p.y[2] = 100;
+	p.x[3] = 100; p.y[3] = 100;
+	p.g = 255;
+
+	GsSortPoly4(&p);
+}
+
+static void bench_gpoly3(int i)
+{
+	GsGPoly3 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 20;
+	p.x[2] = 50; p.y[2] = 100;
+	p.r[0] = 255; p.g[1] = 255; p.b[2] = 255;
+
+	GsSortGPoly3(&p);
+}
+
+static void bench_gpoly4(int i)
+{
+	GsGPoly4 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 10;
+	p.x[2] = i & 63; p.y[2] = 100;
+	p.x[3] = 100; p.y[3] = 100;
+	p.r[0] = 255; p.g[1] = 255; p.b[2] = 255;
+
+	GsSortGPoly4(&p);
+}
+
+static void bench_tpoly3(int i)
+{
+	GsTPoly3 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 20;
+	p.x[2] = 50; p.y[2] = 100;
+	p.u[1] = 63; p.v[2] = 63;
+	p.r = p.g = p.b = NORMAL_LUMINANCE;
+	p.tpage = 5;
+
+	GsSortTPoly3(&p);
+}
+
+static void bench_tpoly4(int i)
+{
+	GsTPoly4 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 10;
+	p.x[2] = i & 63; p.y[2] = 100;
+	p.x[3] = 100; p.y[3] = 100;
+	p.u[1] = 63; p.v[2] = 63; p.u[3] = 63; p.v[3] = 63;
+	p.r = p.g = p.b = NORMAL_LUMINANCE;
+	p.tpage = 5;
+
+	GsSortTPoly4(&p);
+}
+
+static void bench_gtpoly3(int i)
+{
+	GsGTPoly3 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 20;
+	p.x[2] = 50; p.y[2] = 100;
+	p.u[1] = 63; p.v[2] = 63;
+	p.r[0] = 255; p.g[1] = 255; p.b[2] = 255;
+	p.tpage = 5;
+
+	GsSortGTPoly3(&p);
+}
+
+static void bench_gtpoly4(int i)
+{
+	GsGTPoly4 p = {0};
+
+	p.x[0] = i & 63; p.y[0] = 10;
+	p.x[1] = 100; p.y[1] = 10;
+	p.x[2] = i & 63; p.y[2] = 100;
+	p.x[3] = 100; p.y[3] = 100;
+	p.u[1] = 63; p.v[2] = 63; p.u[3] = 63; p.v[3] = 63;
+	p.r[0] = 255; p.g[1] = 255; p.b[2] = 255;
+	p.tpage = 5;
+
+	GsSortGTPoly4(&p);
+}
+
+static void sprite_setup(GsSprite *s, int i)
+{
+	memset(s, 0, sizeof(GsSprite));
+
+	s->x = 32 + (i & 63);
+	s->y = 32;
+	s->w = 32;
+	s->h = 32;
+	s->r = s->g = s->b = NORMAL_LUMINANCE;
+	s->tpage = 5;
+}
+
+static void bench_sprite(int i)
+{
+	GsSprite s;
+
+	sprite_setup(&s, i);
+	GsSortSprite(&s);
+}
+
+static void bench_sprite_scaled(int i)
+{
+	GsSprite s;
+
+	sprite_setup(&s, i);
+	s.scalex = SCALE_ONE + 2048;
+	s.scaley = SCALE_ONE / 2;
+	GsSortSprite(&s);
+}
+
+static void bench_sprite_rotated(int i)
+{
+	GsSprite s;
+
+	sprite_setup(&s, i);
+	s.rotate = ROTATE_ONE * ((i % 359) + 1);
+	s.mx = 16;
+	s.my = 16;
+	GsSortSprite(&s);
+}
+
+static void bench_sprite_flipped(int i)
+{
+	GsSprite s;
+
+	sprite_setup(&s, i);
+	s.attribute = H_FLIP | V_FLIP;
+	GsSortSprite(&s);
+}
+
+static void bench_simple_sprite(int i)
+{
+	GsSprite s;
+
+	sprite_setup(&s, i);
+	GsSortSimpleSprite(&s);
+}
+
+static void bench_line(int i)
+{
+	GsLine l = {0};
+
+	l.x[0] = i & 63; l.y[0] = 10;
+	l.x[1] = 200; l.y[1] = 100;
+	l.r = 255;
+
+	GsSortLine(&l);
+}
+
+static void bench_polyline(int i)
+{
+	GsPolyLine l = {0};
+
+	l.npoints = 8;
+	l.x = pl_x;
+	l.y = pl_y;
+	l.r = 255;
+
+	GsSortPolyLine(&l);
+}
+
+static void bench_gpolyline(int i)
+{
+	GsGPolyLine l = {0};
+
+	l.npoints = 8;
+	l.x = pl_x;
+	l.y = pl_y;
+	l.r = pl_r;
+	l.g = pl_g;
+	l.b = pl_b;
+
+	GsSortGPolyLine(&l);
+}
+
+static void bench_rectangle(int i)
+{
+	GsRectangle r = {0};
+
+	r.x = i & 63; r.y = 10;
+	r.w = 100; r.h = 50;
+	r.b = 255;
+
+	GsSortRectangle(&r);
+}
+
+static void bench_printfont(int i)
+{
+	GsPrintFont(8 + (i & 15), 8, "SCORE %d", i & 0xffff);
+}
+
+static void bench_printfont_scaled(int i)
+{
+	GsSetFontAttrib(PRFONT_SCALE | PRFONT_SCALEX(SCALE_ONE * 2) | PRFONT_SCALEY(SCALE_ONE * 2));
+	GsPrintFont(8 + (i & 15), 8, "SCORE %d", i & 0xffff);
+	GsSetFontAttrib(0);
+}
+
+static void fail(const char *check, const char *what, int a, int b, int c)
+{
+	if(failures < 20)
+		printf("FAIL: %s %s %d,%d,%d\n", check, what, a, b, c);
+
+	failures++;
+}
+
+// Sign extends the 11-bit coordinates of a vertex word.
+static int vertex_x(unsigned int w)
+{
+	return ((int)(w << 21)) >> 21;
+}
+
+static int vertex_y(unsigned int w)
+{
+	return ((int)(w << 5)) >> 21;
+}
+
+#define ROTATE_SIZES	7
+
+static const int rotate_sizes[ROTATE_SIZES] = {1, 8, 16, 31, 64, 100, 256};
+
+// The vertexes of a rotated sprite against the double precision GsRotateVector(),
+// which GsSortSprite() used before: none may be more than one pixel away.
+
+static void check_rotate_sprite(int w, int h, int mx, int my, int a)
+{
+	GsSprite s;
+	double v[3], n[3];
+	unsigned int xy;
+	int x;
+
+	sprite_setup(&s, 0);
+	s.x = 512;
+	s.y = 256;
+	s.w = w;
+	s.h = h;
+	s.mx = mx;
+	s.my = my;
+	s.rotate = ROTATE_ONE * a;
+
+	GsSetList(list);
+	GsSortSprite(&s);
+
+	// A GsTPoly4 packet: header, command and color, then a vertex every other word.
+	for(x = 0; x < 4; x++)
+	{
+		v[0] = (x & 2) ? (w - mx) : -mx;
+		v[1] = (x & 1) ? (my - h) : my;
+		v[2] = 0;
+
+		GsRotateVector(0, 0, s.rotate, v, n);
+		xy = list[2 + (x * 2)];
+
+		if(fabs(vertex_x(xy) - (s.x + mx + n[0])) > 1.0 ||
+			fabs(vertex_y(xy) - (s.y + my + n[1])) > 1.0)
+			fail("rotate", "GsSortSprite w,h,angle", w, h, a);
+	}
+}
+
+// GsRotateVectorFx() against GsRotateVector(), about each axis in turn.
+
+static void check_rotate_vector(int size, int a)
+{
+	double v[3], n[3];
+	int vf[3], nf[3];
+	int ang[3];
+	int axis, x;
+
+	for(axis = 0; axis < 3; axis++)
+	{
+		for(x = 0; x < 3; x++)
+		{
+			vf[x] = (x == axis) ? size : -size / 2;
+			v[x] = vf[x];
+			ang[x] = (x == axis) ? (a * ROTATE_ONE) : 0;
+		}
+
+		GsRotateVector(ang[0], ang[1], ang[2], v, n);
+		GsRotateVectorFx(ang[0], ang[1], ang[2], vf, nf);
+
+		for(x = 0; x < 3; x++)
+		{
+			if(fabs(nf[x] - n[x]) > 1.0)
+				fail("rotate", "GsRotateVectorFx size,angle,axis", size, a, axis);
+		}
+	}
+}
+
+static void check_rotate(void)
+{
+	int a, i, w, h;
+
+	for(i = 0; i < ROTATE_SIZES; i++)
+	{
+		w = rotate_sizes[i];
+		h = rotate_sizes[(i + 1) % ROTATE_SIZES];
+
+		// An angle of 0 does not take the rotation path.
+		for(a = 1; a < 360; a++)
+		{
+			check_rotate_sprite(w, h, w / 2, h / 2, a);
+			check_rotate_sprite(w, h, 0, 0, a);
+		}
+
+		for(a = 0; a < 360; a++)
+			check_rotate_vector(w, a);
+	}
+}
+
+// Scenes drawn by the raster check, with the texture page 5 filled by raster_texture().
+
+static void raster_flat(void)
+{
+	GsPoly3 p3 = {0};
+	GsGPoly4 g4 = {0};
+	GsRectangle r = {0};
+	GsLine l = {0};
+	GsGPolyLine gl = {0};
+
+	r.w = RASTER_W; r.h = RASTER_H;
+	r.r = 16; r.g = 32; r.b = 64;
+	GsSortRectangle(&r);
+
+	p3.x[0] = 20; p3.y[0] = 10;
+	p3.x[1] = 150; p3.y[1] = 40;
+	p3.x[2] = 60; p3.y[2] = 130;
+	p3.r = 255; p3.g = 128;
+	GsSortPoly3(&p3);
+
+	g4.x[0] = 170; g4.y[0] = 20;
+	g4.x[1] = 300; g4.y[1] = 10;
+	g4.x[2] = 160; g4.y[2] = 120;
+	g4.x[3] = 310; g4.y[3] = 140;
+	g4.r[0] = 255; g4.g[1] = 255; g4.b[2] = 255;
+	g4.r[3] = g4.g[3] = g4.b[3] = 128;
+	GsSortGPoly4(&g4);
+
+	// Semi-transparent rectangle, over both polygons
+	r.x = 100; r.y = 60;
+	r.w = 120; r.h = 50;
+	r.r = 0; r.g = 255; r.b = 0;
+	r.attribute = ENABLE_TRANS | TRANS_MODE(0);
+	GsSortRectangle(&r);
+
+	l.x[0] = 5; l.y[0] = 235;
+	l.x[1] = 315; l.y[1] = 150;
+	l.r = l.g = l.b = 255;
+	GsSortLine(&l);
+
+	gl.npoints = 8;
+	gl.x = pl_x;
+	gl.y = pl_y;
+	gl.r = pl_r;
+	gl.g = pl_g;
+	gl.b = pl_b;
+	GsSortGPolyLine(&gl);
+}
+
+static void raster_textured(void)
+{
+	static const unsigned char tiles[6 * 8] =
+	{
+		0, 1, 2, 3, 4, 5, 6, 7,
+		16, 17, 18, 19, 20, 21, 22, 23,
+		32, 33, 34, 35, 36, 37, 38, 39,
+		7, 6, 5, 4, 3, 2, 1, 0,
+		23, 22, 21, 20, 19, 18, 17, 16,
+		39, 38, 37, 36, 35, 34, 33, 32
+	};
+	GsGTPoly3 t3 = {0};
+	GsTPoly4 t4 = {0};
+	GsSprite s;
+	GsMap m = {0};
+
+	m.w = 8; m.h = 6; m.l = 8;
+	m.r = m.g = m.b = NORMAL_LUMINANCE;
+	m.tpage = 5;
+	m.attribute = COLORMODE(COLORMODE_16BPP);
+	m.tmw = m.tmh = 256;
+	m.tw = m.th = 16;
+	m.tsize = 1;
+	m.data = (void*)tiles;
+	GsSortSimpleMap(&m);
+
+	t3.x[0] = 150; t3.y[0] = 5;
+	t3.x[1] = 310; t3.y[1] = 30;
+	t3.x[2] = 200; t3.y[2] = 110;
+	t3.u[1] = 255; t3.v[2] = 255;
+	t3.r[0] = 255; t3.g[1] = 255; t3.b[2] = 255;
+	t3.tpage = 5;
+	t3.attribute = COLORMODE(COLORMODE_16BPP);
+	GsSortGTPoly3(&t3);
+
+	t4.x[0] = 10; t4.y[0] = 120;
+	t4.x[1] = 90; t4.y[1] = 110;
+	t4.x[2] = 20; t4.y[2] = 220;
+	t4.x[3] = 110; t4.y[3] = 230;
+	t4.u[1] = 127; t4.v[2] = 127; t4.u[3] = 127; t4.v[3] = 127;
+	t4.r = t4.g = t4.b = NORMAL_LUMINANCE;
+	t4.tpage = 5;
+	t4.attribute = (COLORMODE(COLORMODE_16BPP)) | ENABLE_TRANS | TRANS_MODE(1);
+	GsSortTPoly4(&t4);
+
+	sprite_setup(&s, 0);
+	s.attribute = COLORMODE(COLORMODE_16BPP);
+	s.x = 130; s.y = 130;
+	s.u = 8; s.v = 24;
+	GsSortSimpleSprite(&s);
+
+	s.x = 170;
+	s.attribute |= H_FLIP;
+	GsSortSprite(&s);
+
+	s.x = 210;
+	s.attribute = COLORMODE(COLORMODE_16BPP);
+	s.scalex = SCALE_ONE + (SCALE_ONE / 2);
+	s.scaley = SCALE_ONE / 2;
+	GsSortSprite(&s);
+
+	s.x = 250; s.y = 180;
+	s.scalex = s.scaley = 0;
+	s.mx = 16; s.my = 16;
+	s.rotate = ROTATE_ONE * 30;
+	GsSortSprite(&s);
+}
+
+static void raster_ot(void)
+{
+	GsRectangle r = {0};
+	int x;
+
+	GsOTInit(&list[LIST_WORDS - OT_ENTRIES], OT_ENTRIES);
+
+	// Plain primitives are drawn before the ordering table
+	r.w = RASTER_W; r.h = RASTER_H;
+	r.r = r.g = r.b = 32;
+	GsSortRectangle(&r);
+
+	// Sorted from the farthest to the nearest, whatever the order they are added in
+	for(x = 0; x < 8; x++)
+	{
+		r.x = 40 + (x * 24);
+		r.y = 40 + (x * 16);
+		r.w = r.h = 80;
+		r.r = x * 32;
+		r.g = 255 - (x * 32);
+		r.b = (x & 1) ? 255 : 0;
+		GsSortRectangleZ(&r, (x * 5) % OT_ENTRIES);
+	}
+}
+
+typedef struct
+{
+	const char *name;
+	void (*draw)(void);
+	unsigned int checksum;
+}gpubench_raster;
+
+// Reference checksums of the drawing area. When a change to gpu.c is meant to
+// alter the output, check the images written with -save and update them.
+static const gpubench_raster rasters[] =
+{
+	{"flat", raster_flat, 0xc2b61d95},
+	{"textured", raster_textured, 0xc006765d},
+	{"ot", raster_ot, 0xb78f89c5},
+	{NULL, NULL, 0}
+};
+
+static void raster_texture(void)
+{
+	unsigned short *vram = gpusim_vram();
+	int u, v;
+
+	for(v = 0; v < 256; v++)
+	{
+		for(u = 0; u < 256; u++)
+		{
+			vram[(v * GPUSIM_VRAM_WIDTH) + 320 + u] = (u >> 3) | ((v >> 3) << 5) |
+				(((u ^ v) & 16) ? (31 << 10) : (8 << 10));
+		}
+	}
+}
+
+// FNV-1a over the drawing area
+
+static unsigned int raster_checksum(void)
+{
+	unsigned short *vram = gpusim_vram();
+	unsigned int h = 2166136261u;
+	int x, y;
+
+	for(y = 0; y < RASTER_H; y++)
+	{
+		for(x = 0; x < RASTER_W; x++)
+		{
+			h = (h ^ (vram[(y * GPUSIM_VRAM_WIDTH) + x] & 0xff)) * 16777619u;
+			h = (h ^ (vram[(y * GPUSIM_VRAM_WIDTH) + x] >> 8)) * 16777619u;
+		}
+	}
+
+	return h;
+}
+
+// Primitive lists built by gpu.c and drawn by gpusim, against reference checksums.
+
+static void check_raster(void)
+{
+	const gpubench_raster *r;
+	char path[64];
+	unsigned int sum;
+
+	for(r = rasters; r->name != NULL; r++)
+	{
+		gpusim_reset();
+		raster_texture();
+
+		gpusim_gp0(0xe3000000);
+		gpusim_gp0(0xe4000000 | ((RASTER_H - 1) << 10) | (RASTER_W - 1));
+		gpusim_gp0(0xe5000000);
+
+		GsSetList(list);
+		r->draw();
+
+		// The stub DMA registers keep the address of the list
+		GsDrawList();
+
+		if(gpusim_run_list(list, sizeof(list), ((uintptr_t)list) & 0xffffff, regs[3]) < 0)
+		{
+			fail("raster", r->name, 0, 0, 0);
+			continue;
+		}
+
+		if(save_raster)
+		{
+			snprintf(path, sizeof(path), "gpubench_%s.tim", r->name);
+			gpusim_save_tim(path, 0, 0, RASTER_W, RASTER_H);
+		}
+
+		sum = raster_checksum();
+
+		if(sum != r->checksum)
+		{
+			if(failures < 20)
+				printf("FAIL: raster %s checksum %08x, expected %08x\n", r->name, sum, r->checksum);
+
+			failures++;
+		}
+	}
+}
+
+static const gpubench_check checks[] =
+{
+	{"rotate", check_rotate},
+	{"raster", check_raster},
+	{NULL, NULL}
+};
+
+static const gpubench_test tests[] =
+{
+	{"GsSortPoly3", bench_poly3},
+	{"GsSortPoly4", bench_poly4},
+	{"GsSortGPoly3", bench_gpoly3},
+	{"GsSortGPoly4", bench_gpoly4},
+	{"GsSortTPoly3", bench_tpoly3},
+	{"GsSortTPoly4", bench_tpoly4},
+	{"GsSortGTPoly3", bench_gtpoly3},
+	{"GsSortGTPoly4", bench_gtpoly4},
+	{"GsSortSprite", bench_sprite},
+	{"GsSortSprite_scaled", bench_sprite_scaled},
+	{"GsSortSprite_rotated", bench_sprite_rotated},
+	{"GsSortSprite_flipped", bench_sprite_flipped},
+	{"GsSortSimpleSprite", bench_simple_sprite},
+	{"GsSortLine", bench_line},
+	{"GsSortPolyLine", bench_polyline},
+	{"GsSortGPolyLine", bench_gpolyline},
+	{"GsSortRectangle", bench_rectangle},
+	{"GsPrintFont", bench_printfont},
+	{"GsPrintFont_scaled", bench_printfont_scaled},
+	{NULL, NULL}
+};
+
+int main(int argc, char *argv[])
+{
+	const gpubench_test *t;
+	const gpubench_check *c;
+	const char *only = NULL;
+	int calls = DEFAULT_CALLS;
+	int x, i;
+	double bytes;
+	clock_t start;
+	double secs;
+	GsDrawEnv env;
+
+	for(x = 1; x < argc; x++)
+	{
+		if(strncmp(argv[x], "-n=", 3) == 0)
+			calls = atoi(argv[x] + 3);
+		else if(strncmp(argv[x], "-only=", 6) == 0)
+			only = argv[x] + 6;
+		else if(strcmp(argv[x], "-save") == 0)
+			save_raster = 1;
+		else
+		{
+			printf("gpubench - measures the cost of building GPU packets with libpsx\n");
+			printf("usage: gpubench [options]\n");
+			printf("\n");
+			printf("Options:\n");
+			printf("  -n=<calls>     - Number of calls for each function (default %d)\n", DEFAULT_CALLS);
+			printf("  -only=<name>   - Only run the test or the check with the specified name\n");
+			printf("  -save          - Save the images drawn by the raster check as gpubench_<scene>.tim\n");
+			printf("\n");
+			printf("Output is CSV: function,calls,seconds,packets_per_second,bytes_per_packet\n");
+			printf("The exit status is 1 if the results of any check are wrong.\n");
+			return -1;
+		}
+	}
+
+	if(calls <= 0)
+		calls = 1;
+
+	memset(&env, 0, sizeof(env));
+	env.w = 320;
+	env.h = 240;
+	GsSetDrawEnv(&env);
+
+	for(c = checks; c->name != NULL; c++)
+	{
+		if(only == NULL || strcmp(only, c->name) == 0)
+			c->check();
+	}
+
+	if(failures > 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("function,calls,seconds,packets_per_second,bytes_per_packet\n");
+
+	for(t = tests; t->name != NULL; t++)
+	{
+		if(only != NULL && strcmp(only, t->name) != 0)
+			continue;
+
+		// Average size of a packet in the list, including its header.
+		GsSetList(list);
+
+		for(i = 0; i < SIZE_CALLS; i++)
+			t->sort(i);
+
+		bytes = (GsListPos() * 4.0) / SIZE_CALLS;
+
+		GsSetList(list);
+		start = clock();
+
+		for(i = 0; i < calls; i++)
+		{
+			if(GsListPos() >= (LIST_WORDS - LIST_MARGIN))
+				GsSetList(list);
+
+			t->sort(i);
+		}
+
+		secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		printf("%s,%d,%.6f,%.0f,%.2f\n", t->name, calls, secs,
+			(secs > 0) ? (calls / secs) : 0.0, bytes);
+	}
+
+	return 0;
+}
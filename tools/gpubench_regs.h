@@ -0,0 +1,18 @@
+#ifndef _GPUBENCH_REGS_H
+#define _GPUBENCH_REGS_H
+
+/*
+ * Stub GPU and DMA registers, used to build libpsx/src/gpu.c on the host for gpubench.
+ * The GPU always reports being ready and DMA transfers end as soon as they are started.
+ */
+
+volatile unsigned int *gpubench_reg(int r);
+
+#define GPU_DATA_PORT		(*gpubench_reg(0))
+#define GPU_CONTROL_PORT	(*gpubench_reg(1))
+#define DPCR			(*gpubench_reg(2))
+#define D2_MADR			(*gpubench_reg(3))
+#define D2_BCR			(*gpubench_reg(4))
+#define D2_CHCR			(*gpubench_reg(5))
+
+#endif
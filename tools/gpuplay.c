@@ -0,0 +1,169 @@
+/*
+ * gpuplay - renders PlayStation GPU packets to a Video RAM image
+ *
+ * The input is either a stream of GP0 words or a memory dump containing
+ * a linked list of packets, like the ones built by libpsx.
+ * The output is a TIM image, which can be converted by tim2bmp,
+ * or a raw Video RAM dump like the ones written by getpsxvram.
+ *
+ * Part of PSXSDK
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gpusim.h"
+
+int main(int argc, char *argv[])
+{
+	FILE *f;
+	unsigned char *buf;
+	unsigned int *words;
+	unsigned int size, x;
+	unsigned int list_addr = 0, base_addr = 0;
+	int use_list = 0, raw = 0, disp = 0;
+	char *vram_file = NULL;
+	int dx, dy, dw, dh;
+	int r;
+	gpusim_stats st;
+
+	if(argc < 3)
+	{
+		printf("gpuplay - renders PlayStation GPU packets to a Video RAM image\n");
+		printf("usage: gpuplay <infile> <outfile> [options]\n");
+		printf("\n");
+		printf("By default the input is a stream of little endian GP0 words.\n");
+		printf("\n");
+		printf("Options:\n");
+		printf("  -list=<addr>  - Input is a memory dump, draw the linked list of packets at <addr>\n");
+		printf("  -base=<addr>  - Address of the first byte of the memory dump (default 0)\n");
+		printf("  -vram=<file>  - Load initial Video RAM contents from a raw dump\n");
+		printf("  -raw          - Write Video RAM as it is, instead of a TIM image\n");
+		printf("  -disp         - Only write the displayed area to the TIM image\n");
+		printf("\n");
+		return -1;
+	}
+
+	for(x = 3; x < argc; x++)
+	{
+		if(strncmp(argv[x], "-list=", 6) == 0)
+		{
+			list_addr = strtoul(argv[x] + 6, NULL, 0);
+			use_list = 1;
+		}
+		else if(strncmp(argv[x], "-base=", 6) == 0)
+			base_addr = strtoul(argv[x] + 6, NULL, 0);
+		else if(strncmp(argv[x], "-vram=", 6) == 0)
+			vram_file = argv[x] + 6;
+		else if(strcmp(argv[x], "-raw") == 0)
+			raw = 1;
+		else if(strcmp(argv[x], "-disp") == 0)
+			disp = 1;
+		else
+		{
+			printf("Unknown option %s.\nAborting.\n", argv[x]);
+			return -1;
+		}
+	}
+
+	gpusim_reset();
+
+	if(vram_file != NULL)
+	{
+		unsigned short *vram = gpusim_vram();
+		unsigned char c[2];
+
+		f = fopen(vram_file, "rb");
+
+		if(f == NULL)
+		{
+			printf("Could not open Video RAM file.\nAborting.\n");
+			return -1;
+		}
+
+		for(x = 0; x < (GPUSIM_VRAM_WIDTH * GPUSIM_VRAM_HEIGHT); x++)
+		{
+			if(fread(c, sizeof(char), 2, f) != 2)
+				break;
+
+			vram[x] = c[0] | (c[1] << 8);
+		}
+
+		fclose(f);
+	}
+
+	f = fopen(argv[1], "rb");
+
+	if(f == NULL)
+	{
+		printf("Could not open input file.\nAborting.\n");
+		return -1;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f) & ~3;
+	fseek(f, 0, SEEK_SET);
+
+	buf = malloc(size);
+	words = malloc(size);
+
+	if(buf == NULL || words == NULL || fread(buf, sizeof(char), size, f) != size)
+	{
+		printf("Could not read input file.\nAborting.\n");
+		return -1;
+	}
+
+	fclose(f);
+
+	for(x = 0; x < (size / 4); x++)
+	{
+		words[x] = buf[x*4] | (buf[(x*4)+1] << 8) |
+			(buf[(x*4)+2] << 16) | (buf[(x*4)+3] << 24);
+	}
+
+	if(use_list)
+	{
+		r = gpusim_run_list(words, size, base_addr & 0xffffff, list_addr);
+
+		if(r < 0)
+			printf("Warning: the linked list points outside the memory dump or does not end.\n");
+	}
+	else
+	{
+		for(x = 0; x < (size / 4); x++)
+			gpusim_gp0(words[x]);
+	}
+
+	if(raw)
+		r = gpusim_save_raw(argv[2]);
+	else if(disp)
+	{
+		gpusim_display_area(&dx, &dy, &dw, &dh);
+
+		if((dx + dw) > GPUSIM_VRAM_WIDTH)
+			dw = GPUSIM_VRAM_WIDTH - dx;
+
+		if((dy + dh) > GPUSIM_VRAM_HEIGHT)
+			dh = GPUSIM_VRAM_HEIGHT - dy;
+
+		r = gpusim_save_tim(argv[2], dx, dy, dw, dh);
+	}
+	else
+		r = gpusim_save_tim(argv[2], 0, 0, GPUSIM_VRAM_WIDTH, GPUSIM_VRAM_HEIGHT);
+
+	if(!r)
+	{
+		printf("Could not write output file.\nAborting.\n");
+		return -1;
+	}
+
+	gpusim_get_stats(&st);
+
+	printf("%u packets, %u words, %u commands, %u pixels\n",
+		st.packets, st.words, st.commands, st.pixels);
+
+	free(buf);
+	free(words);
+
+	return 0;
+}
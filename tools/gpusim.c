@@ -0,0 +1,897 @@
+/*
+ * gpusim - host side PlayStation GPU command interpreter and software rasterizer
+ *
+ * Draws GP0 commands into a 1024x512 16-bit Video RAM image, so that the packets
+ * built by libpsx can be checked and measured without real hardware.
+ *
+ * Part of PSXSDK
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "gpusim.h"
+
+#define CMD_MAX			4096
+#define LIST_MAX_PACKETS	0x100000
+
+typedef struct
+{
+	int x, y;
+	int r, g, b;
+	int u, v;
+}gpusim_vertex;
+
+typedef struct
+{
+	int textured;
+	int raw;
+	int semi;
+	int semi_mode;
+	int dither;
+	int tx, ty;
+	int depth;
+	int cx, cy;
+}gpusim_attr;
+
+static unsigned short vram[GPUSIM_VRAM_HEIGHT][GPUSIM_VRAM_WIDTH];
+
+// Draw mode (0xE1)
+static unsigned int draw_mode;
+static int tpage_x, tpage_y, semi_mode, tex_depth, dither, flip_x, flip_y;
+// Texture window (0xE2)
+static int tw_mask_x, tw_mask_y, tw_off_x, tw_off_y;
+// Drawing area and drawing offset (0xE3, 0xE4, 0xE5)
+static int clip_x1, clip_y1, clip_x2, clip_y2;
+static int off_x, off_y;
+// Mask bit setting (0xE6)
+static int set_mask, check_mask;
+
+// Display settings (GP1)
+static int disp_x, disp_y, disp_mode;
+
+// Command being received
+static unsigned int cmd[CMD_MAX];
+static int cmd_len, cmd_need;
+
+// CPU to Video RAM transfer in progress
+static int load_x, load_y, load_w, load_h, load_pos, load_words;
+
+static gpusim_stats stats;
+
+static const int dither_table[4][4] =
+{
+	{-4, 0, -3, 1},
+	{2, -2, 3, -1},
+	{-3, 1, -4, 0},
+	{3, -1, 2, -2}
+};
+
+static int sign_extend11(unsigned int x)
+{
+	x &= 0x7ff;
+
+	return (x & 0x400) ? (int)x - 0x800 : (int)x;
+}
+
+static int clamp(int x, int min, int max)
+{
+	if(x < min)
+		return min;
+
+	if(x > max)
+		return max;
+
+	return x;
+}
+
+static void reset_state(void)
+{
+	draw_mode = 0;
+	tpage_x = tpage_y = semi_mode = tex_depth = 0;
+	dither = flip_x = flip_y = 0;
+	tw_mask_x = tw_mask_y = tw_off_x = tw_off_y = 0;
+	clip_x1 = clip_y1 = clip_x2 = clip_y2 = 0;
+	off_x = off_y = 0;
+	set_mask = check_mask = 0;
+	disp_x = disp_y = disp_mode = 0;
+	cmd_len = 0;
+	load_words = 0;
+}
+
+void gpusim_reset(void)
+{
+	reset_state();
+	memset(vram, 0, sizeof(vram));
+	gpusim_reset_stats();
+}
+
+static unsigned short blend(unsigned short back, unsigned short front, int mode)
+{
+	int c, b, f, r = 0;
+
+	for(c = 0; c < 15; c += 5)
+	{
+		b = (back >> c) & 31;
+		f = (front >> c) & 31;
+
+		switch(mode)
+		{
+			case 0: b = (b + f) >> 1; break;
+			case 1: b = clamp(b + f, 0, 31); break;
+			case 2: b = clamp(b - f, 0, 31); break;
+			case 3: b = clamp(b + (f >> 2), 0, 31); break;
+		}
+
+		r |= b << c;
+	}
+
+	return r;
+}
+
+static void put_pixel(int x, int y, unsigned short c, int semi, int mode)
+{
+	unsigned short *p = &vram[y][x];
+
+	if(check_mask && (*p & 0x8000))
+		return;
+
+	if(semi)
+		c = blend(*p, c, mode) | (c & 0x8000);
+
+	*p = c | (set_mask << 15);
+
+	stats.pixels++;
+}
+
+static int inside_clip(int x, int y)
+{
+	return x >= clip_x1 && x <= clip_x2 && y >= clip_y1 && y <= clip_y2 &&
+		x >= 0 && x < GPUSIM_VRAM_WIDTH && y >= 0 && y < GPUSIM_VRAM_HEIGHT;
+}
+
+static unsigned short fetch_texel(const gpusim_attr *a, int u, int v)
+{
+	unsigned short w;
+	int y, i;
+
+	u &= 0xff;
+	v &= 0xff;
+
+	// Apply texture window
+	u = (u & ~(tw_mask_x * 8)) | ((tw_off_x & tw_mask_x) * 8);
+	v = (v & ~(tw_mask_y * 8)) | ((tw_off_y & tw_mask_y) * 8);
+
+	y = (a->ty + v) & (GPUSIM_VRAM_HEIGHT - 1);
+
+	switch(a->depth)
+	{
+		case 0:
+			w = vram[y][(a->tx + (u >> 2)) & (GPUSIM_VRAM_WIDTH - 1)];
+			i = (w >> ((u & 3) * 4)) & 0xf;
+		return vram[a->cy][(a->cx + i) & (GPUSIM_VRAM_WIDTH - 1)];
+
+		case 1:
+			w = vram[y][(a->tx + (u >> 1)) & (GPUSIM_VRAM_WIDTH - 1)];
+			i = (w >> ((u & 1) * 8)) & 0xff;
+		return vram[a->cy][(a->cx + i) & (GPUSIM_VRAM_WIDTH - 1)];
+	}
+
+	return vram[y][(a->tx + u) & (GPUSIM_VRAM_WIDTH - 1)];
+}
+
+/*
+ * Shades and writes a single pixel.
+ * r, g and b are 8-bit; for textured primitives they modulate the texel,
+ * with 128 leaving it unchanged.
+ */
+static void shade_pixel(const gpusim_attr *a, int x, int y,
+			int r, int g, int b, int u, int v)
+{
+	unsigned short t, c;
+	int semi = a->semi;
+
+	if(a->textured)
+	{
+		t = fetch_texel(a, u, v);
+
+		// Fully transparent
+		if(t == 0)
+			return;
+
+		semi = semi && (t & 0x8000);
+
+		if(a->raw)
+		{
+			put_pixel(x, y, t, semi, a->semi_mode);
+			return;
+		}
+
+		r = ((t & 31) * r) >> 4;
+		g = (((t >> 5) & 31) * g) >> 4;
+		b = (((t >> 10) & 31) * b) >> 4;
+		c = t & 0x8000;
+	}
+	else
+		c = 0;
+
+	if(a->dither)
+	{
+		r += dither_table[y & 3][x & 3];
+		g += dither_table[y & 3][x & 3];
+		b += dither_table[y & 3][x & 3];
+	}
+
+	r = clamp(r, 0, 255) >> 3;
+	g = clamp(g, 0, 255) >> 3;
+	b = clamp(b, 0, 255) >> 3;
+
+	put_pixel(x, y, c | r | (g << 5) | (b << 10), semi, a->semi_mode);
+}
+
+static long long edge(const gpusim_vertex *a, const gpusim_vertex *b, int x, int y)
+{
+	return (long long)(b->x - a->x) * (y - a->y) - (long long)(b->y - a->y) * (x - a->x);
+}
+
+/*
+ * Pixels lying exactly on an edge are only drawn for top and left edges,
+ * so the right and bottom edges of a polygon are left out like the GPU does
+ * and the two halves of a quad never overlap.
+ */
+static int is_top_left(const gpusim_vertex *a, const gpusim_vertex *b)
+{
+	int dx = b->x - a->x;
+	int dy = b->y - a->y;
+
+	return (dy < 0) || (dy == 0 && dx > 0);
+}
+
+static void draw_triangle(const gpusim_attr *a, const gpusim_vertex *v0,
+			const gpusim_vertex *v1, const gpusim_vertex *v2)
+{
+	const gpusim_vertex *t;
+	long long area, w0, w1, w2;
+	int min_x, min_y, max_x, max_y;
+	int tl0, tl1, tl2;
+	int x, y;
+
+	area = edge(v0, v1, v2->x, v2->y);
+
+	if(area == 0)
+		return;
+
+	if(area < 0)
+	{
+		t = v1;
+		v1 = v2;
+		v2 = t;
+		area = -area;
+	}
+
+	min_x = v0->x; max_x = v0->x;
+	min_y = v0->y; max_y = v0->y;
+
+	if(v1->x < min_x) min_x = v1->x;
+	if(v2->x < min_x) min_x = v2->x;
+	if(v1->x > max_x) max_x = v1->x;
+	if(v2->x > max_x) max_x = v2->x;
+	if(v1->y < min_y) min_y = v1->y;
+	if(v2->y < min_y) min_y = v2->y;
+	if(v1->y > max_y) max_y = v1->y;
+	if(v2->y > max_y) max_y = v2->y;
+
+	// The GPU does not draw polygons which are too big.
+	if((max_x - min_x) >= 1024 || (max_y - min_y) >= 512)
+		return;
+
+	min_x = clamp(min_x, clip_x1, clip_x2);
+	max_x = clamp(max_x, clip_x1, clip_x2);
+	min_y = clamp(min_y, clip_y1, clip_y2);
+	max_y = clamp(max_y, clip_y1, clip_y2);
+
+	tl0 = is_top_left(v1, v2);
+	tl1 = is_top_left(v2, v0);
+	tl2 = is_top_left(v0, v1);
+
+	for(y = min_y; y <= max_y; y++)
+	{
+		for(x = min_x; x <= max_x; x++)
+		{
+			w0 = edge(v1, v2, x, y);
+			w1 = edge(v2, v0, x, y);
+			w2 = edge(v0, v1, x, y);
+
+			if(w0 < 0 || w1 < 0 || w2 < 0)
+				continue;
+
+			if((w0 == 0 && !tl0) || (w1 == 0 && !tl1) || (w2 == 0 && !tl2))
+				continue;
+
+			if(!inside_clip(x, y))
+				continue;
+
+			shade_pixel(a, x, y,
+				(v0->r * w0 + v1->r * w1 + v2->r * w2) / area,
+				(v0->g * w0 + v1->g * w1 + v2->g * w2) / area,
+				(v0->b * w0 + v1->b * w1 + v2->b * w2) / area,
+				(v0->u * w0 + v1->u * w1 + v2->u * w2) / area,
+				(v0->v * w0 + v1->v * w1 + v2->v * w2) / area);
+		}
+	}
+}
+
+static int div_round(int a, int b)
+{
+	if(a < 0)
+		return -((-a + (b / 2)) / b);
+
+	return (a + (b / 2)) / b;
+}
+
+static void draw_line(const gpusim_attr *a, const gpusim_vertex *p0, const gpusim_vertex *p1)
+{
+	int dx = p1->x - p0->x;
+	int dy = p1->y - p0->y;
+	int steps, i, x, y;
+
+	if(dx >= 1024 || dx <= -1024 || dy >= 512 || dy <= -512)
+		return;
+
+	steps = (dx < 0) ? -dx : dx;
+
+	if(((dy < 0) ? -dy : dy) > steps)
+		steps = (dy < 0) ? -dy : dy;
+
+	for(i = 0; i <= steps; i++)
+	{
+		if(steps == 0)
+		{
+			x = p0->x;
+			y = p0->y;
+		}
+		else
+		{
+			x = p0->x + div_round(dx * i, steps);
+			y = p0->y + div_round(dy * i, steps);
+		}
+
+		if(!inside_clip(x, y))
+			continue;
+
+		if(steps == 0)
+			shade_pixel(a, x, y, p0->r, p0->g, p0->b, 0, 0);
+		else
+			shade_pixel(a, x, y,
+				p0->r + div_round((p1->r - p0->r) * i, steps),
+				p0->g + div_round((p1->g - p0->g) * i, steps),
+				p0->b + div_round((p1->b - p0->b) * i, steps), 0, 0);
+	}
+}
+
+static void draw_rect(const gpusim_attr *a, const gpusim_vertex *p, int w, int h)
+{
+	int i, j, x, y;
+
+	for(j = 0; j < h; j++)
+	{
+		y = p->y + j;
+
+		for(i = 0; i < w; i++)
+		{
+			x = p->x + i;
+
+			if(!inside_clip(x, y))
+				continue;
+
+			shade_pixel(a, x, y, p->r, p->g, p->b,
+				flip_x ? (p->u - i) : (p->u + i),
+				flip_y ? (p->v - j) : (p->v + j));
+		}
+	}
+}
+
+static void set_color(gpusim_vertex *v, unsigned int c)
+{
+	v->r = c & 0xff;
+	v->g = (c >> 8) & 0xff;
+	v->b = (c >> 16) & 0xff;
+}
+
+static void set_position(gpusim_vertex *v, unsigned int xy)
+{
+	v->x = sign_extend11(xy) + off_x;
+	v->y = sign_extend11(xy >> 16) + off_y;
+}
+
+static void set_texpage(unsigned int t)
+{
+	tpage_x = t & 0xf;
+	tpage_y = (t >> 4) & 1;
+	semi_mode = (t >> 5) & 3;
+	tex_depth = (t >> 7) & 3;
+}
+
+static void setup_attr(gpusim_attr *a, unsigned int op, int textured, unsigned int clut)
+{
+	a->textured = textured;
+	a->raw = textured && (op & 1);
+	a->semi = (op & 2) ? 1 : 0;
+	a->semi_mode = semi_mode;
+	a->dither = 0;
+	a->tx = tpage_x * 64;
+	a->ty = tpage_y * 256;
+	a->depth = tex_depth;
+	a->cx = (clut & 0x3f) * 16;
+	a->cy = (clut >> 6) & 0x1ff;
+}
+
+static void exec_polygon(void)
+{
+	gpusim_vertex v[4];
+	gpusim_attr a;
+	unsigned int op = cmd[0] >> 24;
+	int textured = (op & 4) ? 1 : 0;
+	int gouraud = (op & 0x10) ? 1 : 0;
+	int verts = (op & 8) ? 4 : 3;
+	unsigned int clut = 0;
+	int n, i = 1;
+
+	for(n = 0; n < verts; n++)
+	{
+		if(gouraud && n > 0)
+			set_color(&v[n], cmd[i++]);
+		else
+			set_color(&v[n], cmd[0]);
+
+		set_position(&v[n], cmd[i++]);
+
+		if(textured)
+		{
+			v[n].u = cmd[i] & 0xff;
+			v[n].v = (cmd[i] >> 8) & 0xff;
+
+			if(n == 0)
+				clut = cmd[i] >> 16;
+			else if(n == 1)
+				set_texpage(cmd[i] >> 16);
+
+			i++;
+		}
+		else
+		{
+			v[n].u = 0;
+			v[n].v = 0;
+		}
+	}
+
+	setup_attr(&a, op, textured, clut);
+	a.dither = dither && (gouraud || (textured && !a.raw));
+
+	draw_triangle(&a, &v[0], &v[1], &v[2]);
+
+	if(verts == 4)
+		draw_triangle(&a, &v[1], &v[2], &v[3]);
+}
+
+static void exec_line(void)
+{
+	gpusim_vertex p0, p1;
+	gpusim_attr a;
+	unsigned int op = cmd[0] >> 24;
+	int gouraud = (op & 0x10) ? 1 : 0;
+	int i = 1;
+
+	setup_attr(&a, op, 0, 0);
+	a.dither = dither && gouraud;
+
+	set_color(&p0, cmd[0]);
+	set_position(&p0, cmd[i++]);
+
+	while(i < cmd_len)
+	{
+		if(gouraud)
+			set_color(&p1, cmd[i++]);
+		else
+			set_color(&p1, cmd[0]);
+
+		set_position(&p1, cmd[i++]);
+
+		draw_line(&a, &p0, &p1);
+
+		p0 = p1;
+	}
+}
+
+static void exec_rect(void)
+{
+	gpusim_vertex p;
+	gpusim_attr a;
+	unsigned int op = cmd[0] >> 24;
+	int textured = (op & 4) ? 1 : 0;
+	unsigned int clut = 0;
+	int w, h, i = 1;
+
+	set_color(&p, cmd[0]);
+	set_position(&p, cmd[i++]);
+
+	if(textured)
+	{
+		p.u = cmd[i] & 0xff;
+		p.v = (cmd[i] >> 8) & 0xff;
+		clut = cmd[i] >> 16;
+		i++;
+	}
+	else
+	{
+		p.u = 0;
+		p.v = 0;
+	}
+
+	switch((op >> 3) & 3)
+	{
+		case 0:
+			w = cmd[i] & 0x3ff;
+			h = (cmd[i] >> 16) & 0x1ff;
+		break;
+		case 1: w = h = 1; break;
+		case 2: w = h = 8; break;
+		default: w = h = 16; break;
+	}
+
+	setup_attr(&a, op, textured, clut);
+
+	draw_rect(&a, &p, w, h);
+}
+
+static void exec_fill(void)
+{
+	int x = cmd[1] & 0x3f0;
+	int y = (cmd[1] >> 16) & 0x1ff;
+	int w = ((cmd[2] & 0x3ff) + 15) & ~15;
+	int h = (cmd[2] >> 16) & 0x1ff;
+	unsigned short c;
+	int i, j;
+
+	c = ((cmd[0] >> 3) & 31) | (((cmd[0] >> 11) & 31) << 5) | (((cmd[0] >> 19) & 31) << 10);
+
+	// Filling ignores the drawing area and the mask bit settings.
+	for(j = 0; j < h; j++)
+	{
+		for(i = 0; i < w; i++)
+			vram[(y + j) & (GPUSIM_VRAM_HEIGHT - 1)][(x + i) & (GPUSIM_VRAM_WIDTH - 1)] = c;
+	}
+
+	stats.pixels += w * h;
+}
+
+static void exec_copy(void)
+{
+	int sx = cmd[1] & 0x3ff;
+	int sy = (cmd[1] >> 16) & 0x1ff;
+	int dx = cmd[2] & 0x3ff;
+	int dy = (cmd[2] >> 16) & 0x1ff;
+	int w = (((cmd[3] & 0xffff) - 1) & 0x3ff) + 1;
+	int h = ((((cmd[3] >> 16) & 0xffff) - 1) & 0x1ff) + 1;
+	int i, j;
+
+	for(j = 0; j < h; j++)
+	{
+		for(i = 0; i < w; i++)
+		{
+			put_pixel((dx + i) & (GPUSIM_VRAM_WIDTH - 1), (dy + j) & (GPUSIM_VRAM_HEIGHT - 1),
+				vram[(sy + j) & (GPUSIM_VRAM_HEIGHT - 1)][(sx + i) & (GPUSIM_VRAM_WIDTH - 1)], 0, 0);
+		}
+	}
+}
+
+static void load_halfword(unsigned short h)
+{
+	if(load_pos >= (load_w * load_h))
+		return;
+
+	put_pixel((load_x + (load_pos % load_w)) & (GPUSIM_VRAM_WIDTH - 1),
+		(load_y + (load_pos / load_w)) & (GPUSIM_VRAM_HEIGHT - 1), h, 0, 0);
+
+	load_pos++;
+}
+
+static void exec_environment(void)
+{
+	unsigned int w = cmd[0];
+
+	switch(w >> 24)
+	{
+		case 0xe1:
+			draw_mode = w & 0x3fff;
+			set_texpage(w);
+			dither = (w >> 9) & 1;
+			flip_x = (w >> 12) & 1;
+			flip_y = (w >> 13) & 1;
+		break;
+		case 0xe2:
+			tw_mask_x = w & 31;
+			tw_mask_y = (w >> 5) & 31;
+			tw_off_x = (w >> 10) & 31;
+			tw_off_y = (w >> 15) & 31;
+		break;
+		case 0xe3:
+			clip_x1 = w & 0x3ff;
+			clip_y1 = (w >> 10) & 0x1ff;
+		break;
+		case 0xe4:
+			clip_x2 = w & 0x3ff;
+			clip_y2 = (w >> 10) & 0x1ff;
+		break;
+		case 0xe5:
+			off_x = sign_extend11(w);
+			off_y = sign_extend11(w >> 11);
+		break;
+		case 0xe6:
+			set_mask = w & 1;
+			check_mask = (w >> 1) & 1;
+		break;
+	}
+}
+
+// Returns the length of a GP0 command in words, or 0 for polylines, which end with a terminator.
+static int cmd_size(unsigned int c)
+{
+	unsigned int op = c >> 24;
+	int n;
+
+	switch(op >> 5)
+	{
+		case 1:
+			n = (op & 8) ? 4 : 3;
+
+			if(op & 0x10)
+				return 1 + (n * ((op & 4) ? 2 : 1)) + (n - 1);
+
+			return 1 + (n * ((op & 4) ? 2 : 1));
+		case 2:
+			if(op & 8)
+				return 0;
+
+			return (op & 0x10) ? 4 : 3;
+		case 3:
+			n = 2;
+
+			if(op & 4)
+				n++;
+
+			if(!(op & 0x18))
+				n++;
+
+			return n;
+		case 4:
+			return 4;
+		case 5:
+		case 6:
+			return 3;
+	}
+
+	if(op == 0x02)
+		return 3;
+
+	return 1;
+}
+
+static void exec_command(void)
+{
+	unsigned int op = cmd[0] >> 24;
+
+	stats.commands++;
+
+	switch(op >> 5)
+	{
+		case 1: exec_polygon(); return;
+		case 2: exec_line(); return;
+		case 3: exec_rect(); return;
+		case 4: exec_copy(); return;
+
+		case 5:
+			load_x = cmd[1] & 0x3ff;
+			load_y = (cmd[1] >> 16) & 0x1ff;
+			load_w = (((cmd[2] & 0xffff) - 1) & 0x3ff) + 1;
+			load_h = ((((cmd[2] >> 16) & 0xffff) - 1) & 0x1ff) + 1;
+			load_pos = 0;
+			load_words = ((load_w * load_h) + 1) / 2;
+		return;
+
+		case 6:
+			// Video RAM to CPU transfers are not emulated.
+		return;
+
+		case 7: exec_environment(); return;
+	}
+
+	if(op == 0x02)
+		exec_fill();
+}
+
+void gpusim_gp0(unsigned int word)
+{
+	stats.words++;
+
+	if(load_words > 0)
+	{
+		load_halfword(word & 0xffff);
+		load_halfword(word >> 16);
+		load_words--;
+		return;
+	}
+
+	cmd[cmd_len++] = word;
+
+	if(cmd_len == 1)
+		cmd_need = cmd_size(word);
+
+	if(cmd_need == 0)
+	{
+		// Polyline: at least two vertices, then the terminator.
+		int gouraud = (cmd[0] >> 24) & 0x10;
+
+		if(cmd_len > (gouraud ? 4 : 3) && (word & 0xf000f000) == 0x50005000)
+		{
+			cmd_len--;
+			exec_command();
+			cmd_len = 0;
+		}
+		else if(cmd_len == CMD_MAX)
+			cmd_len = 0;
+
+		return;
+	}
+
+	if(cmd_len < cmd_need)
+		return;
+
+	exec_command();
+	cmd_len = 0;
+}
+
+void gpusim_gp1(unsigned int word)
+{
+	switch(word >> 24)
+	{
+		case 0x00:
+			reset_state();
+		break;
+		case 0x01:
+			cmd_len = 0;
+			load_words = 0;
+		break;
+		case 0x05:
+			disp_x = word & 0x3fe;
+			disp_y = (word >> 10) & 0x1ff;
+		break;
+		case 0x08:
+			disp_mode = word & 0x7f;
+		break;
+	}
+}
+
+unsigned int gpusim_status(void)
+{
+	return (draw_mode & 0x7ff) | (set_mask << 11) | (check_mask << 12) |
+		(1 << 26) | (1 << 27) | (1 << 28);
+}
+
+int gpusim_run_list(const unsigned int *ram, unsigned int ram_size,
+			unsigned int ram_addr, unsigned int list_addr)
+{
+	unsigned int addr = list_addr & 0xffffff;
+	unsigned int off, hdr, len, x;
+	int n;
+
+	for(n = 1; n <= LIST_MAX_PACKETS; n++)
+	{
+		off = (addr - ram_addr) & 0xffffff;
+
+		if((off & 3) || off >= ram_size)
+			return -1;
+
+		hdr = ram[off >> 2];
+		len = hdr >> 24;
+
+		if((off + 4 + (len * 4)) > ram_size)
+			return -1;
+
+		for(x = 0; x < len; x++)
+			gpusim_gp0(ram[(off >> 2) + 1 + x]);
+
+		stats.packets++;
+
+		if((hdr & 0xffffff) == 0xffffff)
+			return n;
+
+		addr = hdr & 0xffffff;
+	}
+
+	return -1;
+}
+
+unsigned short *gpusim_vram(void)
+{
+	return &vram[0][0];
+}
+
+void gpusim_display_area(int *x, int *y, int *w, int *h)
+{
+	static const int widths[4] = {256, 320, 512, 640};
+
+	*x = disp_x;
+	*y = disp_y;
+	*w = (disp_mode & 0x40) ? 368 : widths[disp_mode & 3];
+	*h = ((disp_mode & 4) && (disp_mode & 0x20)) ? 480 : 240;
+}
+
+static void put_le_word(FILE *f, unsigned short w)
+{
+	fputc(w & 0xff, f);
+	fputc(w >> 8, f);
+}
+
+static void put_le_dword(FILE *f, unsigned int d)
+{
+	put_le_word(f, d & 0xffff);
+	put_le_word(f, d >> 16);
+}
+
+int gpusim_save_raw(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	int x, y;
+
+	if(f == NULL)
+		return 0;
+
+	for(y = 0; y < GPUSIM_VRAM_HEIGHT; y++)
+		for(x = 0; x < GPUSIM_VRAM_WIDTH; x++)
+			put_le_word(f, vram[y][x]);
+
+	fclose(f);
+
+	return 1;
+}
+
+int gpusim_save_tim(const char *path, int x, int y, int w, int h)
+{
+	FILE *f;
+	int i, j;
+
+	if(x < 0 || y < 0 || w <= 0 || h <= 0 ||
+		(x + w) > GPUSIM_VRAM_WIDTH || (y + h) > GPUSIM_VRAM_HEIGHT)
+		return 0;
+
+	f = fopen(path, "wb");
+
+	if(f == NULL)
+		return 0;
+
+	put_le_dword(f, 0x10);
+	put_le_dword(f, 2); // 16-bit, no CLUT
+	put_le_dword(f, 12 + (w * h * 2));
+	put_le_word(f, x);
+	put_le_word(f, y);
+	put_le_word(f, w);
+	put_le_word(f, h);
+
+	for(j = 0; j < h; j++)
+		for(i = 0; i < w; i++)
+			put_le_word(f, vram[y + j][x + i]);
+
+	fclose(f);
+
+	return 1;
+}
+
+void gpusim_get_stats(gpusim_stats *s)
+{
+	*s = stats;
+}
+
+void gpusim_reset_stats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,60 @@
+#ifndef _PSX_GPUSIM_H
+#define _PSX_GPUSIM_H
+
+/*
+ * gpusim - host side PlayStation GPU command interpreter and software rasterizer
+ *
+ * Consumes the same words the GPU would receive through its GP0 and GP1 ports
+ * and draws them into a 1024x512 16-bit Video RAM image.
+ * Reading back Video RAM through GPUREAD (command 0xC0) is not emulated.
+ */
+
+#define GPUSIM_VRAM_WIDTH	1024
+#define GPUSIM_VRAM_HEIGHT	512
+
+typedef struct
+{
+	unsigned int packets; // Linked list nodes walked by gpusim_run_list()
+	unsigned int words; // Words written to GP0
+	unsigned int commands; // GP0 commands executed
+	unsigned int pixels; // Pixels written to Video RAM
+}gpusim_stats;
+
+// Resets the GPU state and clears Video RAM.
+void gpusim_reset(void);
+
+// Writes a word to the GP0 (data) port.
+void gpusim_gp0(unsigned int word);
+
+// Writes a word to the GP1 (control) port.
+void gpusim_gp1(unsigned int word);
+
+// Returns the GPU status register; the GPU is always ready.
+unsigned int gpusim_status(void);
+
+/*
+ * Walks a linked list of packets like the DMA controller does and sends them to GP0.
+ * ram points to a copy of memory whose first byte is at address ram_addr (24-bit),
+ * ram_size is its size in bytes and list_addr is the address of the first packet.
+ * Returns the number of packets walked, or -1 if the list points outside ram
+ * or does not end.
+ */
+int gpusim_run_list(const unsigned int *ram, unsigned int ram_size,
+			unsigned int ram_addr, unsigned int list_addr);
+
+// Returns a pointer to Video RAM, GPUSIM_VRAM_WIDTH * GPUSIM_VRAM_HEIGHT halfwords.
+unsigned short *gpusim_vram(void);
+
+// Gets the position and size of the displayed area, as set through GP1.
+void gpusim_display_area(int *x, int *y, int *w, int *h);
+
+// Saves Video RAM as it is, in the same format as "getpsxvram raw".
+int gpusim_save_raw(const char *path);
+
+// Saves a Video RAM rectangle as a 16-bit TIM image, which tim2bmp can convert.
+int gpusim_save_tim(const char *path, int x, int y, int w, int h);
+
+void gpusim_get_stats(gpusim_stats *stats);
+void gpusim_reset_stats(void);
+
+#endif
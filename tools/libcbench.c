@@ -0,0 +1,590 @@
+/*
+ * libcbench - checks and measures the PSXSDK C library functions on the host
+ *
+ * libpsx/src/libc/string.c and qsort.c are built for the host with their symbols
+ * prefixed by psx_ (see the Makefile), so that each function can be compared
+ * with the one of the host C library: first the results are checked on random
+ * sizes and alignments, then the speed of both is measured.
+ * The output is CSV, so that results from different SDK revisions can be compared.
+ *
+ * Part of PSXSDK
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#define BUF_SIZE		8192
+#define CHECK_ROUNDS		20000
+#define DEFAULT_BYTES		(64 * 1024 * 1024)
+#define SORT_MAX		4096
+#define SORT_MAX_SIZE		12
+
+void *psx_memcpy(void *dst, const void *src, unsigned int len);
+void *psx_memmove(void *dst, const void *src, unsigned int len);
+void *psx_memset(void *dst, char c, unsigned int n);
+int psx_memcmp(const void *b1, const void *b2, unsigned int n);
+int psx_strlen(const char *s);
+int psx_strnlen(const char *s, unsigned int maxlen);
+char *psx_strchr(const char *s, int c);
+char *psx_strrchr(const char *s, int c);
+int psx_strcmp(const char *s1, const char *s2);
+void *psx_memchr(void *s, int c, unsigned int n);
+void psx_qsort(void *base, unsigned int nmemb, unsigned int size, int (*compar)(const void *, const void *));
+
+static unsigned char buf_a[BUF_SIZE + 64];
+static unsigned char buf_b[BUF_SIZE + 64];
+static unsigned char buf_c[BUF_SIZE + 64];
+static unsigned char sort_in[SORT_MAX * SORT_MAX_SIZE + 4];
+static unsigned char sort_a[SORT_MAX * SORT_MAX_SIZE + 4];
+static unsigned char sort_b[SORT_MAX * SORT_MAX_SIZE + 4];
+static int failures;
+
+// Functions string.c needs from the rest of libpsx
+
+void *psx_malloc(unsigned int size)
+{
+	return malloc(size);
+}
+
+int psx_tolower(int c)
+{
+	return tolower(c);
+}
+
+int psx_toupper(int c)
+{
+	return toupper(c);
+}
+
+int psx_isspace(int c)
+{
+	return isspace(c);
+}
+
+static void fill_random(unsigned char *buf, int len)
+{
+	int x;
+
+	for(x = 0; x < len; x++)
+		buf[x] = rand();
+}
+
+static void fail(const char *func, int size, int off_a, int off_b)
+{
+	if(failures < 20)
+		printf("FAIL: %s size=%d offsets=%d,%d\n", func, size, off_a, off_b);
+
+	failures++;
+}
+
+static int sign(int x)
+{
+	return (x > 0) - (x < 0);
+}
+
+static void check_mem(void)
+{
+	int r, size, oa, ob, d;
+
+	for(r = 0; r < CHECK_ROUNDS; r++)
+	{
+		size = (r & 1) ? (rand() % 64) : (rand() % 2048);
+		oa = rand() & 7;
+		ob = rand() & 7;
+
+		// memcpy
+		fill_random(buf_a, sizeof(buf_a));
+		fill_random(buf_b, sizeof(buf_b));
+		memcpy(buf_c, buf_b, sizeof(buf_b));
+		psx_memcpy(buf_b + ob, buf_a + oa, size);
+		memcpy(buf_c + ob, buf_a + oa, size);
+
+		if(memcmp(buf_b, buf_c, sizeof(buf_b)) != 0)
+			fail("memcpy", size, oa, ob);
+
+		// memset
+		d = rand();
+		psx_memset(buf_b + ob, d, size);
+		memset(buf_c + ob, d, size);
+
+		if(memcmp(buf_b, buf_c, sizeof(buf_b)) != 0)
+			fail("memset", size, 0, ob);
+
+		// memmove, both ways and overlapping
+		d = (rand() % 64) - 32;
+		oa = 32 + (rand() & 7);
+		ob = oa + d;
+		memcpy(buf_c, buf_a, sizeof(buf_a));
+		psx_memmove(buf_a + ob, buf_a + oa, size);
+		memmove(buf_c + ob, buf_c + oa, size);
+
+		if(memcmp(buf_a, buf_c, sizeof(buf_a)) != 0)
+			fail("memmove", size, oa, ob);
+
+		// memcmp, equal and with one difference
+		oa = rand() & 7;
+		ob = rand() & 7;
+		memcpy(buf_b + ob, buf_a + oa, size);
+
+		if(size > 0 && (rand() & 1))
+			buf_b[ob + (rand() % size)] ^= 1 << (rand() & 7);
+
+		if(sign(psx_memcmp(buf_a + oa, buf_b + ob, size)) !=
+			sign(memcmp(buf_a + oa, buf_b + ob, size)))
+			fail("memcmp", size, oa, ob);
+	}
+}
+
+// Fills a buffer with a string of the specified length, made of the letters a to h
+// so that the characters searched for are found at random places.
+
+static void fill_string(unsigned char *buf, int len)
+{
+	int x;
+
+	for(x = 0; x < len; x++)
+		buf[x] = 'a' + (rand() & 7);
+
+	buf[len] = 0;
+}
+
+static void check_str(void)
+{
+	int r, size, oa, ob, c, n;
+	char *a, *b;
+
+	for(r = 0; r < CHECK_ROUNDS; r++)
+	{
+		size = (r & 1) ? (rand() % 64) : (rand() % 2048);
+		oa = rand() & 7;
+		ob = rand() & 7;
+		a = (char*)buf_a + oa;
+		b = (char*)buf_b + ob;
+
+		fill_random(buf_a, sizeof(buf_a));
+		fill_string((unsigned char*)a, size);
+
+		if(psx_strlen(a) != strlen(a))
+			fail("strlen", size, oa, 0);
+
+		n = rand() % (size + 8);
+
+		if(psx_strnlen(a, n) != strnlen(a, n))
+			fail("strnlen", size, oa, n);
+
+		// Characters both present and missing, the terminator, and one with bit 7 set
+		c = (r % 5 == 0) ? 0 : (r % 5 == 1) ? 0xe1 : ('a' + (rand() % 10));
+
+		if(psx_strchr(a, c) != strchr(a, c))
+			fail("strchr", size, oa, c);
+
+		if(psx_strrchr(a, c) != strrchr(a, c))
+			fail("strrchr", size, oa, c);
+
+		n = rand() % (size + 8);
+
+		if(psx_memchr(buf_a + oa, c, n) != memchr(buf_a + oa, c, n))
+			fail("memchr", n, oa, c);
+
+		// strcmp, equal, with one difference, and with a shorter string
+		memcpy(b, a, size + 1);
+
+		if(size > 0)
+		{
+			switch(rand() % 3)
+			{
+				case 0:
+					b[rand() % size] ^= 1 << (rand() & 7);
+				break;
+				case 1:
+					b[rand() % size] = 0;
+				break;
+			}
+		}
+
+		if(sign(psx_strcmp(a, b)) != sign(strcmp(a, b)))
+			fail("strcmp", size, oa, ob);
+	}
+}
+
+// Elements are sorted by their first four bytes, read as an unsigned int
+
+static int compare_key(const void *a, const void *b)
+{
+	unsigned int ka, kb;
+
+	memcpy(&ka, a, 4);
+	memcpy(&kb, b, 4);
+
+	return (ka > kb) - (ka < kb);
+}
+
+static int compare_byte(const void *a, const void *b)
+{
+	return *(const unsigned char*)a - *(const unsigned char*)b;
+}
+
+static size_t sort_size;
+
+static int compare_whole(const void *a, const void *b)
+{
+	return memcmp(a, b, sort_size);
+}
+
+static void check_qsort(void)
+{
+	static const int sizes[] = {1, 3, 4, 8, 12};
+	int (*compar)(const void *, const void *);
+	int r, x, n, size, off, keys;
+	unsigned char *a;
+
+	for(r = 0; r < CHECK_ROUNDS / 10; r++)
+	{
+		size = sizes[rand() % (sizeof(sizes) / sizeof(int))];
+		n = (r & 1) ? (rand() % 64) : (rand() % SORT_MAX);
+		off = (size & 3) ? (rand() & 3) : 0;
+		compar = (size < 4) ? compare_byte : compare_key;
+		a = sort_a + off;
+
+		// Few different keys, many different keys, sorted and reversed
+		keys = (r & 2) ? 4 : 0x7fffffff;
+		fill_random(sort_in, n * size);
+
+		for(x = 0; x < n; x++)
+		{
+			unsigned int k = rand() % keys;
+
+			if(size >= 4)
+				memcpy(sort_in + (x * size), &k, 4);
+			else
+				sort_in[x * size] = k;
+		}
+
+		if((r % 7) == 0)
+			qsort(sort_in, n, size, compar);
+
+		if((r % 7) == 1)
+		{
+			qsort(sort_in, n, size, compar);
+
+			for(x = 0; x < n / 2; x++)
+			{
+				memcpy(sort_b, sort_in + (x * size), size);
+				memcpy(sort_in + (x * size), sort_in + ((n - 1 - x) * size), size);
+				memcpy(sort_in + ((n - 1 - x) * size), sort_b, size);
+			}
+		}
+
+		memcpy(a, sort_in, n * size);
+		psx_qsort(a, n, size, compar);
+
+		for(x = 1; x < n; x++)
+		{
+			if(compar(a + ((x - 1) * size), a + (x * size)) > 0)
+			{
+				fail("qsort", n, off, size);
+				break;
+			}
+		}
+
+		// The result must hold the same elements as the input
+		sort_size = size;
+		memcpy(sort_b, sort_in, n * size);
+		qsort(a, n, size, compare_whole);
+		qsort(sort_b, n, size, compare_whole);
+
+		if(memcmp(a, sort_b, n * size) != 0)
+			fail("qsort", n, off, size);
+	}
+}
+
+static double seconds(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(const char *func, int size, int misaligned, double psx, double host, long long bytes)
+{
+	printf("%s,%d,%d,%.1f,%.1f\n", func, size, misaligned,
+		(psx > 0) ? (bytes / psx / 1048576.0) : 0.0,
+		(host > 0) ? (bytes / host / 1048576.0) : 0.0);
+}
+
+static void bench_mem(long long bytes)
+{
+	static const int sizes[] = {16, 64, 256, 2048, 8000};
+	volatile int sink = 0;
+	clock_t start;
+	double tp, th;
+	long long n, x;
+	int s, mis, size;
+
+	fill_random(buf_a, sizeof(buf_a));
+
+	for(s = 0; s < sizeof(sizes) / sizeof(int); s++)
+	{
+		size = sizes[s];
+		n = bytes / size;
+
+		for(mis = 0; mis <= 1; mis++)
+		{
+			start = clock();
+			for(x = 0; x < n; x++)
+				psx_memcpy(buf_b, buf_a + mis, size);
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				memcpy(buf_b, buf_a + mis, size);
+			th = seconds(start);
+
+			report("memcpy", size, mis, tp, th, n * size);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				psx_memmove(buf_a + mis, buf_a + 4, size);
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				memmove(buf_a + mis, buf_a + 4, size);
+			th = seconds(start);
+
+			report("memmove", size, mis, tp, th, n * size);
+		}
+
+		start = clock();
+		for(x = 0; x < n; x++)
+			psx_memset(buf_b + (x & 1), x, size);
+		tp = seconds(start);
+
+		start = clock();
+		for(x = 0; x < n; x++)
+			memset(buf_b + (x & 1), x, size);
+		th = seconds(start);
+
+		report("memset", size, 1, tp, th, n * size);
+
+		memcpy(buf_b, buf_a, size);
+
+		start = clock();
+		for(x = 0; x < n; x++)
+			sink += psx_memcmp(buf_a, buf_b, size);
+		tp = seconds(start);
+
+		start = clock();
+		for(x = 0; x < n; x++)
+			sink += memcmp(buf_a, buf_b, size);
+		th = seconds(start);
+
+		report("memcmp", size, 0, tp, th, n * size);
+	}
+}
+
+static void bench_str(long long bytes)
+{
+	static const int sizes[] = {16, 64, 256, 2048, 8000};
+	volatile long sink = 0;
+	clock_t start;
+	double tp, th;
+	long long n, x;
+	int s, mis, size;
+	char *a, *b;
+
+	for(s = 0; s < sizeof(sizes) / sizeof(int); s++)
+	{
+		size = sizes[s];
+		n = bytes / size;
+
+		for(mis = 0; mis <= 1; mis++)
+		{
+			a = (char*)buf_a + mis;
+			b = (char*)buf_b + mis;
+
+			// 'z' is never in the string, so the whole string is scanned
+			memset(a, 'a', size);
+			a[size] = 0;
+			memcpy(b, a, size + 1);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += psx_strlen(a);
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += strlen(a);
+			th = seconds(start);
+
+			report("strlen", size, mis, tp, th, n * size);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)psx_strchr(a, 'z');
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)strchr(a, 'z');
+			th = seconds(start);
+
+			report("strchr", size, mis, tp, th, n * size);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)psx_strrchr(a, 'z');
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)strrchr(a, 'z');
+			th = seconds(start);
+
+			report("strrchr", size, mis, tp, th, n * size);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)psx_memchr(a, 'z', size);
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += (long)memchr(a, 'z', size);
+			th = seconds(start);
+
+			report("memchr", size, mis, tp, th, n * size);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += psx_strcmp(a, b);
+			tp = seconds(start);
+
+			start = clock();
+			for(x = 0; x < n; x++)
+				sink += strcmp(a, b);
+			th = seconds(start);
+
+			report("strcmp", size, mis, tp, th, n * size);
+		}
+	}
+}
+
+static void bench_qsort(long long bytes)
+{
+	static const int counts[] = {16, 256, 4096};
+	static const int sizes[] = {4, 8, 12};
+	static const char *names[] = {"qsort_random", "qsort_sorted", "qsort_reversed"};
+	clock_t start;
+	double tp, th;
+	long long n, x;
+	int c, s, order, count, size, y;
+
+	for(c = 0; c < sizeof(counts) / sizeof(int); c++)
+	{
+		count = counts[c];
+
+		for(s = 0; s < sizeof(sizes) / sizeof(int); s++)
+		{
+			size = sizes[s];
+			n = bytes / (count * size) / 16;
+
+			if(n < 1)
+				n = 1;
+
+			for(order = 0; order < 3; order++)
+			{
+				fill_random(sort_in, count * size);
+
+				for(y = 0; y < count; y++)
+				{
+					unsigned int k = (order == 0) ? (unsigned int)rand() :
+						(order == 1) ? (unsigned int)y : (unsigned int)(count - y);
+
+					memcpy(sort_in + (y * size), &k, 4);
+				}
+
+				start = clock();
+				for(x = 0; x < n; x++)
+				{
+					memcpy(sort_a, sort_in, count * size);
+					psx_qsort(sort_a, count, size, compare_key);
+				}
+				tp = seconds(start);
+
+				start = clock();
+				for(x = 0; x < n; x++)
+				{
+					memcpy(sort_a, sort_in, count * size);
+					qsort(sort_a, count, size, compare_key);
+				}
+				th = seconds(start);
+
+				report(names[order], count * size, 0, tp, th, n * count * size);
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	long long bytes = DEFAULT_BYTES;
+	const char *only = NULL;
+	int x;
+
+	for(x = 1; x < argc; x++)
+	{
+		if(strncmp(argv[x], "-bytes=", 7) == 0)
+			bytes = atoll(argv[x] + 7);
+		else if(strncmp(argv[x], "-only=", 6) == 0)
+			only = argv[x] + 6;
+		else
+		{
+			printf("libcbench - checks and measures the PSXSDK C library functions on the host\n");
+			printf("usage: libcbench [options]\n");
+			printf("\n");
+			printf("Options:\n");
+			printf("  -bytes=<n>     - Bytes processed by each speed test (default %d)\n", DEFAULT_BYTES);
+			printf("  -only=<group>  - Only run one group of tests: mem, str, qsort\n");
+			printf("\n");
+			printf("Output is CSV: function,size,misaligned,psx_mb_per_second,host_mb_per_second\n");
+			printf("The exit status is 1 if the results of any function are wrong.\n");
+			return -1;
+		}
+	}
+
+	if(bytes <= 0)
+		bytes = 1;
+
+	srand(1);
+
+	if(only == NULL || strcmp(only, "mem") == 0)
+		check_mem();
+
+	if(only == NULL || strcmp(only, "str") == 0)
+		check_str();
+
+	if(only == NULL || strcmp(only, "qsort") == 0)
+		check_qsort();
+
+	if(failures > 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("function,size,misaligned,psx_mb_per_second,host_mb_per_second\n");
+
+	if(only == NULL || strcmp(only, "mem") == 0)
+		bench_mem(bytes);
+
+	if(only == NULL || strcmp(only, "str") == 0)
+		bench_str(bytes);
+
+	if(only == NULL || strcmp(only, "qsort") == 0)
+		bench_qsort(bytes);
+
+	return 0;
+}